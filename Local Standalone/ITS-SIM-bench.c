@@ -0,0 +1,133 @@
+// ITS-SIM-bench.c
+
+#include "ITS-SIM.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+static double seconds(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void printStats(const char *name, const sim_t *sim, size_t n, double elapsed) {
+	printf("%-10s %10.0f ops/s  rounds %llu  renormalized %llu  opened %llu  masks %llu\n", name, n / elapsed,
+	       (unsigned long long)sim->stats.rounds, (unsigned long long)sim->stats.renormalized,
+	       (unsigned long long)sim->stats.opened, (unsigned long long)sim->stats.masks);
+}
+
+/*********************************************************************************
+ * @brief Check a batch of random inputs against cleartext results and time each protocol.
+ *        Run it again with the printed seed to replay a failure.
+ *********************************************************************************/
+int main(int argc, char *argv[]) {
+	size_t n = (argc > 1) ? strtoull(argv[1], NULL, 10) : 100000;
+	uint64_t seed = (argc > 2) ? strtoull(argv[2], NULL, 10) : (uint64_t)time(NULL);
+	printf("n = %zu, seed = %llu\n", n, (unsigned long long)seed);
+
+	sim_t sim;
+	sim_shares_t a, b, z;
+	int32_t *u = malloc(n * sizeof(int32_t)), *v = malloc(n * sizeof(int32_t));
+	int32_t *c = malloc(n * sizeof(int32_t)), *e = malloc(n * sizeof(int32_t));
+	if (!u || !v || !c || !e || simInit(&sim, seed) != 0 || simAlloc(&a, n) != 0 || simAlloc(&b, n) != 0 ||
+	    simAlloc(&z, n) != 0) {
+		perror("alloc");
+		return 1;
+	}
+	simRandom(&sim, u, n);
+	simRandom(&sim, v, n);
+	for (size_t i = 0; i < n; i += 7) {
+		v[i] = u[i]; // Make sure equal pairs are covered
+	}
+	size_t failures = 0;
+
+	// Addition
+	simSplit(&sim, &a, u);
+	simSplit(&sim, &b, v);
+	simResetStats(&sim);
+	double start = seconds();
+	simAdd(&z, &a, &b);
+	double elapsed = seconds() - start;
+	simReconstruct(&z, c);
+	for (size_t i = 0; i < n; i++) {
+		failures += c[i] != (u[i] + v[i]) % MOD;
+	}
+	printStats("add", &sim, n, elapsed);
+
+	// Multiplication
+	start = seconds();
+	if (simMul(&sim, &z, &a, &b) != 0) {
+		perror("simMul");
+		return 1;
+	}
+	elapsed = seconds() - start;
+	simReconstruct(&z, c);
+	for (size_t i = 0; i < n; i++) {
+		failures += c[i] != (int32_t)((int64_t)u[i] * v[i] % MOD);
+	}
+	printStats("mul", &sim, n, elapsed);
+
+	// Parallel comparison
+	simResetStats(&sim);
+	start = seconds();
+	if (simCompare(&sim, u, v, n, c, e) != 0) {
+		perror("simCompare");
+		return 1;
+	}
+	elapsed = seconds() - start;
+	for (size_t i = 0; i < n; i++) {
+		failures += c[i] != (u[i] >= v[i]) || e[i] != (u[i] == v[i]);
+	}
+	printStats("compare", &sim, n, elapsed);
+
+	// The comparisons agent.c runs, on 14-bit operands
+	const uint32_t w = 14;
+	sim_shares_t ubits, vbits, out;
+	if (simAlloc(&ubits, n * w) != 0 || simAlloc(&vbits, n * w) != 0 || simAlloc(&out, n) != 0 ||
+	    simShareBits(&sim, u, n, w, &ubits) != 0 || simShareBits(&sim, v, n, w, &vbits) != 0) {
+		perror("alloc");
+		return 1;
+	}
+	for (int kind = 0; kind < 8; kind++) {
+		static const char *names[] = {"lt", "ltc", "eq", "eqc", "lt-pre", "ltc-pre", "eq-pre", "eqc-pre"};
+		int isLT = kind % 4 < 2;
+		simResetStats(&sim);
+		start = seconds();
+		int status;
+		switch (kind) {
+		case 0: status = simLT(&sim, &ubits, &vbits, w, &out); break;
+		case 1: status = simLTPublic(&sim, &ubits, v, w, &out); break;
+		case 2: status = simEQ(&sim, &ubits, &vbits, w, &out); break;
+		case 3: status = simEQPublic(&sim, &ubits, v, w, &out); break;
+		case 4: status = simLTPre(&sim, &ubits, &vbits, w, &out); break;
+		case 5: status = simLTPublicPre(&sim, &ubits, v, w, &out); break;
+		case 6: status = simEQPre(&sim, &ubits, &vbits, w, &out); break;
+		default: status = simEQPublicPre(&sim, &ubits, v, w, &out); break;
+		}
+		elapsed = seconds() - start;
+		if (status != 0) {
+			perror(names[kind]);
+			return 1;
+		}
+		simReconstruct(&out, c);
+		for (size_t i = 0; i < n; i++) {
+			failures += c[i] != (isLT ? u[i] < v[i] : u[i] == v[i]);
+		}
+		printStats(names[kind], &sim, n, elapsed);
+	}
+	simRelease(&ubits);
+	simRelease(&vbits);
+	simRelease(&out);
+
+	printf("%zu failures\n", failures);
+	simRelease(&a);
+	simRelease(&b);
+	simRelease(&z);
+	simFree(&sim);
+	free(u);
+	free(v);
+	free(c);
+	free(e);
+	return failures != 0;
+}
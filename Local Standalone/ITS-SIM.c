@@ -0,0 +1,903 @@
+// ITS-SIM.c
+
+#include "ITS-SIM.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define SIM_BITS 14 // (int32_t)(log2(MOD - 1)) + 1, as in CompareParallelTest
+
+/*********************************************************************************
+ * @brief Reduce a non-negative value below 2^31 mod MOD.
+ * @note Division by a constant compiles to a multiply and shift, which vectorizes.
+ *********************************************************************************/
+static inline uint32_t reduce(uint32_t x) {
+	return x % MOD;
+}
+
+static int32_t *allocLanes(size_t n) {
+	size_t bytes = (n * sizeof(int32_t) + SIM_ALIGN - 1) / SIM_ALIGN * SIM_ALIGN;
+	return aligned_alloc(SIM_ALIGN, bytes ? bytes : SIM_ALIGN);
+}
+
+/*********************************************************************************
+ * @brief View of count secrets of x starting at secret off. Nothing is copied.
+ *********************************************************************************/
+static sim_shares_t slice(const sim_shares_t *x, size_t off, size_t count) {
+	sim_shares_t view = {count, {NULL}};
+	for (int32_t j = 0; j < NP; j++) {
+		view.s[j] = x->s[j] + off;
+	}
+	return view;
+}
+
+/*********************************************************************************
+ * @brief Make sure the scratch buffer holds at least n values.
+ * @return int: 0 on success, -1 if memory runs out
+ *********************************************************************************/
+static int reserveScratch(sim_t *sim, size_t n) {
+	if (sim->scratchLen >= n) return 0;
+	int32_t *grown = allocLanes(n);
+	if (!grown) return -1;
+	free(sim->scratch);
+	sim->scratch = grown;
+	sim->scratchLen = n;
+	return 0;
+}
+
+/*********************************************************************************
+ * @brief Set up a simulator.
+ * @param sim_t *sim: simulator to initialize
+ * @param uint64_t seed: seed of the random stream; equal seeds give equal shares
+ * @return int: 0 on success
+ *********************************************************************************/
+int simInit(sim_t *sim, uint64_t seed) {
+	memset(sim, 0, sizeof *sim);
+	sim->seed = seed;
+	return 0;
+}
+
+void simFree(sim_t *sim) {
+	free(sim->scratch);
+	sim->scratch = NULL;
+	sim->scratchLen = 0;
+}
+
+void simResetStats(sim_t *sim) {
+	memset(&sim->stats, 0, sizeof sim->stats);
+}
+
+/*********************************************************************************
+ * @brief Allocate shares for a batch of n secrets.
+ * @return int: 0 on success, -1 if memory runs out
+ *********************************************************************************/
+int simAlloc(sim_shares_t *x, size_t n) {
+	x->n = n;
+	for (int32_t j = 0; j < NP; j++) {
+		x->s[j] = allocLanes(n);
+		if (!x->s[j]) {
+			simRelease(x);
+			return -1;
+		}
+	}
+	return 0;
+}
+
+void simRelease(sim_shares_t *x) {
+	for (int32_t j = 0; j < NP; j++) {
+		free(x->s[j]);
+		x->s[j] = NULL;
+	}
+	x->n = 0;
+}
+
+/*********************************************************************************
+ * @brief Draw n values in [0, MOD).
+ * Value k of the stream is output k of splitmix64 seeded with seed. Lanes do not depend on
+ * each other, so the loop vectorizes on targets with 64-bit vector multiplies (AVX-512). The
+ * final multiply-shift maps 32 random bits onto [0, MOD) with a bias below 2^-18, which is
+ * fine for a simulator.
+ * @param sim_t *sim: simulator whose stream advances by n
+ * @param int32_t *out: output values
+ * @param size_t n: number of values
+ *********************************************************************************/
+void simRandom(sim_t *sim, int32_t *restrict out, size_t n) {
+	const uint64_t base = sim->seed + sim->counter * 0x9E3779B97F4A7C15ull;
+	for (size_t i = 0; i < n; i++) {
+		uint64_t z = base + (uint64_t)(i + 1) * 0x9E3779B97F4A7C15ull;
+		z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+		z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+		z ^= z >> 31;
+		out[i] = (int32_t)(((z >> 32) * MOD) >> 32);
+	}
+	sim->counter += n;
+}
+
+/*********************************************************************************
+ * @brief Share a batch of secrets with fresh degree-1 polynomials, like SPLIT.
+ * @param sim_t *sim: simulator
+ * @param sim_shares_t *x: allocated output of x->n shares
+ * @param const int32_t *secrets: x->n secrets, reduced mod MOD first
+ * @return int: 0 on success, -1 if memory runs out
+ *********************************************************************************/
+int simSplit(sim_t *sim, sim_shares_t *x, const int32_t *restrict secrets) {
+	const size_t n = x->n;
+	if (reserveScratch(sim, n) != 0) return -1;
+	int32_t *restrict r = sim->scratch;
+	simRandom(sim, r, n);
+	for (int32_t j = 0; j < NP; j++) {
+		int32_t *restrict s = x->s[j];
+		for (size_t i = 0; i < n; i++) {
+			int32_t p = secrets[i] % MOD;
+			p += (p < 0) ? MOD : 0;
+			s[i] = (int32_t)reduce((uint32_t)((j + 1) * r[i] + p));
+		}
+	}
+	return 0;
+}
+
+/*********************************************************************************
+ * @brief Reconstruct a batch of secrets with the gamma coefficients, like RECONSTRUCT.
+ * @param const sim_shares_t *x: shares of x->n secrets
+ * @param int32_t *secrets: x->n outputs in [0, MOD)
+ *********************************************************************************/
+void simReconstruct(const sim_shares_t *x, int32_t *restrict secrets) {
+	const int32_t *restrict s0 = x->s[0], *restrict s1 = x->s[1], *restrict s2 = x->s[2];
+	for (size_t i = 0; i < x->n; i++) {
+		uint32_t sum = reduce((uint32_t)(GAMMA1 * s0[i]) + (uint32_t)(GAMMA2 * s1[i]));
+		secrets[i] = (int32_t)reduce(sum + (uint32_t)(GAMMA3 * s2[i]));
+	}
+}
+
+/*********************************************************************************
+ * @brief Local linear operations, applied by every party to its own lanes.
+ * Outputs may alias inputs. Shares keep their degree.
+ *********************************************************************************/
+void simAdd(sim_shares_t *z, const sim_shares_t *x, const sim_shares_t *y) {
+	for (int32_t j = 0; j < NP; j++) {
+		const int32_t *a = x->s[j], *b = y->s[j];
+		int32_t *out = z->s[j];
+		for (size_t i = 0; i < z->n; i++) {
+			out[i] = (int32_t)reduce((uint32_t)(a[i] + b[i]));
+		}
+	}
+}
+
+void simSub(sim_shares_t *z, const sim_shares_t *x, const sim_shares_t *y) {
+	for (int32_t j = 0; j < NP; j++) {
+		const int32_t *a = x->s[j], *b = y->s[j];
+		int32_t *out = z->s[j];
+		for (size_t i = 0; i < z->n; i++) {
+			out[i] = (int32_t)reduce((uint32_t)(a[i] - b[i] + MOD));
+		}
+	}
+}
+
+/*********************************************************************************
+ * @brief Add a public constant to every secret. The constant polynomial c has share c at
+ *        every party.
+ *********************************************************************************/
+void simAddPublic(sim_shares_t *z, const sim_shares_t *x, int32_t c) {
+	uint32_t k = (uint32_t)(c % MOD + MOD);
+	for (int32_t j = 0; j < NP; j++) {
+		const int32_t *a = x->s[j];
+		int32_t *out = z->s[j];
+		for (size_t i = 0; i < z->n; i++) {
+			out[i] = (int32_t)reduce((uint32_t)a[i] + k);
+		}
+	}
+}
+
+void simScale(sim_shares_t *z, const sim_shares_t *x, int32_t c) {
+	uint32_t k = (uint32_t)(c % MOD + MOD) % MOD;
+	for (int32_t j = 0; j < NP; j++) {
+		const int32_t *a = x->s[j];
+		int32_t *out = z->s[j];
+		for (size_t i = 0; i < z->n; i++) {
+			out[i] = (int32_t)reduce((uint32_t)a[i] * k);
+		}
+	}
+}
+
+/*********************************************************************************
+ * @brief Multiply share by share. The result is a degree-2 sharing and must be
+ *        renormalized before it is multiplied again.
+ *********************************************************************************/
+void simMulLocal(sim_shares_t *z, const sim_shares_t *x, const sim_shares_t *y) {
+	for (int32_t j = 0; j < NP; j++) {
+		const int32_t *a = x->s[j], *b = y->s[j];
+		int32_t *out = z->s[j];
+		for (size_t i = 0; i < z->n; i++) {
+			out[i] = (int32_t)reduce((uint32_t)a[i] * (uint32_t)b[i]);
+		}
+	}
+}
+
+/*********************************************************************************
+ * @brief Renormalization kernel over n lanes.
+ * @param int32_t *s0, *s1, *s2: each party's shares, replaced by degree-1 shares
+ * @param const int32_t *rnd: 5 * n random values: r_U, its slope, and the three reshare slopes
+ * @note Restrict parameters let the compiler vectorize without run-time alias checks.
+ *********************************************************************************/
+static void renormalizeLanes(int32_t *restrict s0, int32_t *restrict s1, int32_t *restrict s2, const int32_t *restrict rnd, size_t n) {
+	const int32_t *rU = rnd, *coeffR = rnd + n, *coeff0 = rnd + 2 * n, *coeff1 = rnd + 3 * n, *coeff2 = rnd + 4 * n;
+	for (size_t i = 0; i < n; i++) {
+		// Step 1: Random shares [r_U]_k = r_U + coeffR * (k + 1)
+		uint32_t r0 = reduce((uint32_t)(rU[i] + coeffR[i]));
+		uint32_t r1 = reduce((uint32_t)(rU[i] + 2 * coeffR[i]));
+		uint32_t r2 = reduce((uint32_t)(rU[i] + 3 * coeffR[i]));
+
+		// Step 2: d_j = s_j + [r_U]_j
+		uint32_t d0 = reduce((uint32_t)s0[i] + r0);
+		uint32_t d1 = reduce((uint32_t)s1[i] + r1);
+		uint32_t d2 = reduce((uint32_t)s2[i] + r2);
+
+		// Steps 3 and 4: party k combines the reshares [d_j]^k = d_j + coeff_j * (k + 1)
+		uint32_t base = reduce(GAMMA1 * d0 + GAMMA2 * d1) + GAMMA3 * d2;
+		uint32_t slope = reduce(GAMMA1 * (uint32_t)coeff0[i] + GAMMA2 * (uint32_t)coeff1[i]) + GAMMA3 * (uint32_t)coeff2[i];
+		s0[i] = (int32_t)reduce(base + slope + 3 * MOD - r0);
+		s1[i] = (int32_t)reduce(base + 2 * slope + 3 * MOD - r1);
+		s2[i] = (int32_t)reduce(base + 3 * slope + 3 * MOD - r2);
+	}
+}
+
+/*********************************************************************************
+ * @brief Renormalize a batch of degree-2 sharings back to degree 1, as in RENORMALIZE.
+ * One call is one interaction round for the whole batch.
+ * @param sim_t *sim: simulator
+ * @param sim_shares_t *x: shares to renormalize (modified in-place)
+ * @return int: 0 on success, -1 if memory runs out
+ * @note Based on Protocol 2.
+ *********************************************************************************/
+int simRenormalize(sim_t *sim, sim_shares_t *x) {
+	if (x->n == 0) return 0; // Like the agent, an empty layer costs no round
+	if (reserveScratch(sim, 5 * x->n) != 0) return -1;
+	simRandom(sim, sim->scratch, 5 * x->n);
+	renormalizeLanes(x->s[0], x->s[1], x->s[2], sim->scratch, x->n);
+	sim->stats.rounds++;
+	sim->stats.renormalized += x->n;
+	return 0;
+}
+
+/*********************************************************************************
+ * @brief Multiply two batches: a local product followed by one renormalization.
+ * @return int: 0 on success, -1 if memory runs out
+ *********************************************************************************/
+int simMul(sim_t *sim, sim_shares_t *z, const sim_shares_t *x, const sim_shares_t *y) {
+	simMulLocal(z, x, y);
+	return simRenormalize(sim, z);
+}
+
+/*********************************************************************************
+ * @brief Batched CompareParallelTest, the baseline protocol: c = 1 if u >= v, e = 1 if u == v.
+ * The agents no longer run this protocol. simLT, simEQ and their variants below mirror the
+ * kernels in agent.c.
+ * The server shares the bits of every pair MSB first, bit-major, so that each bit position is
+ * one contiguous layer. The agents then run the same rounds as CompareParallelTest, but each
+ * round covers the whole batch:
+ *   - one round for [u_j v_j], [gt_j] and [lt_j] over every bit;
+ *   - SIM_BITS - 1 rounds for the prefix equalities;
+ *   - one round for the flags;
+ *   - one opening of [cmp].
+ * @param sim_t *sim: simulator
+ * @param const int32_t *u, *v: n pairs of values in [0, 2^SIM_BITS)
+ * @param size_t n: number of pairs
+ * @param int32_t *c, *e: n outputs each
+ * @return int: 0 on success, -1 if memory runs out
+ *********************************************************************************/
+int simCompare(sim_t *sim, const int32_t *u, const int32_t *v, size_t n, int32_t *c, int32_t *e) {
+	const size_t nl = n * SIM_BITS;
+	int32_t *bits = malloc(2 * nl * sizeof(int32_t));
+	sim_shares_t uv = {0}, x = {0}, y = {0}, prefix = {0}, cmp = {0};
+	int status = -1;
+	if (!bits) return -1;
+	if (simAlloc(&uv, 2 * nl) != 0 || simAlloc(&x, 3 * nl) != 0 || simAlloc(&y, 3 * nl) != 0 ||
+	    simAlloc(&prefix, nl) != 0 || simAlloc(&cmp, n) != 0)
+		goto done;
+
+	// Server Actions: share the bits of u and v, layer b holding bit SIM_BITS - 1 - b
+	for (size_t b = 0; b < SIM_BITS; b++) {
+		for (size_t i = 0; i < n; i++) {
+			bits[b * n + i] = (u[i] >> (SIM_BITS - 1 - b)) & 1;
+			bits[nl + b * n + i] = (v[i] >> (SIM_BITS - 1 - b)) & 1;
+		}
+	}
+	if (simSplit(sim, &uv, bits) != 0) goto done;
+	sim_shares_t us = slice(&uv, 0, nl), vs = slice(&uv, nl, nl);
+
+	// Round 1: [u_j v_j], [gt_j] = [u_j](1 - [v_j]) and [lt_j] = (1 - [u_j])[v_j] in one batch
+	sim_shares_t x0 = slice(&x, 0, nl), x1 = slice(&x, nl, nl), x2 = slice(&x, 2 * nl, nl);
+	sim_shares_t y0 = slice(&y, 0, nl), y1 = slice(&y, nl, nl), y2 = slice(&y, 2 * nl, nl);
+	for (int32_t j = 0; j < NP; j++) {
+		memcpy(x0.s[j], us.s[j], nl * sizeof(int32_t));
+		memcpy(x1.s[j], us.s[j], nl * sizeof(int32_t));
+		memcpy(y0.s[j], vs.s[j], nl * sizeof(int32_t));
+		memcpy(y2.s[j], vs.s[j], nl * sizeof(int32_t));
+	}
+	simScale(&x2, &us, MOD - 1);
+	simAddPublic(&x2, &x2, 1);
+	simScale(&y1, &vs, MOD - 1);
+	simAddPublic(&y1, &y1, 1);
+	if (simMul(sim, &x, &x, &y) != 0) goto done;
+	sim_shares_t prod = x0, gt = x1, lt = x2;
+
+	// [eq_j] = 1 - ([u_j] + [v_j] - 2[u_j v_j]), kept in y0
+	sim_shares_t eq = y0;
+	simAdd(&eq, &us, &vs);
+	simScale(&prod, &prod, 2);
+	simSub(&eq, &eq, &prod);
+	simScale(&eq, &eq, MOD - 1);
+	simAddPublic(&eq, &eq, 1);
+
+	// Prefix equalities: [prefixEq_0] = 1, [prefixEq_b] = [prefixEq_{b-1}][eq_{b-1}]
+	sim_shares_t prefix0 = slice(&prefix, 0, n);
+	for (int32_t j = 0; j < NP; j++) {
+		for (size_t i = 0; i < n; i++) {
+			prefix0.s[j][i] = 1;
+		}
+	}
+	for (size_t b = 1; b < SIM_BITS; b++) {
+		sim_shares_t prev = slice(&prefix, (b - 1) * n, n), cur = slice(&prefix, b * n, n);
+		sim_shares_t eqPrev = slice(&eq, (b - 1) * n, n);
+		if (simMul(sim, &cur, &prev, &eqPrev) != 0) goto done;
+	}
+
+	// [flag_b] = [prefixEq_b]([gt_b] - [lt_b]), then [cmp] = sum of the flags
+	simSub(&gt, &gt, &lt);
+	if (simMul(sim, &gt, &prefix, &gt) != 0) goto done;
+	for (int32_t j = 0; j < NP; j++) {
+		memcpy(cmp.s[j], gt.s[j], n * sizeof(int32_t));
+	}
+	for (size_t b = 1; b < SIM_BITS; b++) {
+		sim_shares_t flag = slice(&gt, b * n, n);
+		simAdd(&cmp, &cmp, &flag);
+	}
+
+	// Open [cmp]: non-negative differences land in [0, MOD / 2]
+	simReconstruct(&cmp, c);
+	for (size_t i = 0; i < n; i++) {
+		e[i] = c[i] == 0;
+		c[i] = c[i] <= MOD / 2;
+	}
+	sim->stats.rounds++;
+	sim->stats.opened += n;
+	status = 0;
+
+done:
+	free(bits);
+	simRelease(&uv);
+	simRelease(&x);
+	simRelease(&y);
+	simRelease(&prefix);
+	simRelease(&cmp);
+	return status;
+}
+
+/*********************************************************************************
+ * @brief Share the w-bit decompositions of n values, as the primary does for a comparison.
+ * @param sim_t *sim: simulator
+ * @param const int32_t *values: n values in [0, 2^w)
+ * @param size_t n: number of values
+ * @param uint32_t w: bits per value
+ * @param sim_shares_t *bits: allocated output of n*w shares, bit j of value i at i*w + j, MSB first
+ * @return int: 0 on success, -1 if memory runs out
+ *********************************************************************************/
+int simShareBits(sim_t *sim, const int32_t *values, size_t n, uint32_t w, sim_shares_t *bits) {
+	const size_t total = n * w;
+	int32_t *plain = malloc((total ? total : 1) * sizeof(int32_t));
+	if (!plain) return -1;
+	for (size_t i = 0; i < n; i++) {
+		for (uint32_t j = 0; j < w; j++) {
+			plain[i * w + j] = (values[i] >> (w - 1 - j)) & 1;
+		}
+	}
+	sim_shares_t view = slice(bits, 0, total);
+	int status = simSplit(sim, &view, plain);
+	free(plain);
+	return status;
+}
+
+/*********************************************************************************
+ * @brief Open a batch of shares of degree 2 or less in one round, like runOPENBatch.
+ * @param sim_t *sim: simulator
+ * @param const sim_shares_t *x: shares to open
+ * @param int32_t *values: x->n opened values
+ *********************************************************************************/
+void simOpen(sim_t *sim, const sim_shares_t *x, int32_t *values) {
+	if (x->n == 0) return;
+	simReconstruct(x, values);
+	sim->stats.rounds++;
+	sim->stats.opened += x->n;
+}
+
+/*********************************************************************************
+ * @brief Finish n less than comparisons from their per-bit eq and lt shares, like prefixLT.
+ * @param sim_t *sim: simulator
+ * @param sim_shares_t *eq: n*w shares of eq_j (overwritten by the prefix scan)
+ * @param const sim_shares_t *lt: n*w shares of lt_j
+ * @param uint32_t w: bits per operand
+ * @param sim_shares_t *out: n shares of sum_j prefixEq_j * lt_j
+ * @return int: 0 on success, -1 if memory runs out
+ * @note Rounds: ceil(log2(w-1)) for the Hillis-Steele prefix product, one for the flags.
+ *********************************************************************************/
+static int prefixLT(sim_t *sim, sim_shares_t *eq, const sim_shares_t *lt, uint32_t w, sim_shares_t *out) {
+	const size_t n = out->n;
+	sim_shares_t tmp;
+	if (simAlloc(&tmp, n * w) != 0) return -1;
+
+	for (uint32_t d = 1; d + 1 < w; d <<= 1) {
+		size_t c = 0;
+		for (int32_t p = 0; p < NP; p++) {
+			const int32_t *e = eq->s[p];
+			int32_t *t = tmp.s[p];
+			c = 0;
+			for (size_t i = 0; i < n; i++) {
+				for (uint32_t j = d; j + 1 < w; j++) {
+					t[c++] = (int32_t)reduce((uint32_t)e[i * w + j] * (uint32_t)e[i * w + j - d]);
+				}
+			}
+		}
+		sim_shares_t layer = slice(&tmp, 0, c);
+		if (simRenormalize(sim, &layer) != 0) goto fail;
+		for (int32_t p = 0; p < NP; p++) {
+			const int32_t *t = tmp.s[p];
+			c = 0;
+			for (size_t i = 0; i < n; i++) {
+				for (uint32_t j = d; j + 1 < w; j++) {
+					eq->s[p][i * w + j] = t[c++];
+				}
+			}
+		}
+	}
+
+	// flag_j = prefixEq_j * lt_j, where prefixEq_j = eq[j-1] after the scan and prefixEq_0 = 1
+	size_t c = 0;
+	for (int32_t p = 0; p < NP; p++) {
+		const int32_t *e = eq->s[p], *lo = lt->s[p];
+		int32_t *t = tmp.s[p];
+		c = 0;
+		for (size_t i = 0; i < n; i++) {
+			for (uint32_t j = 1; j < w; j++) {
+				t[c++] = (int32_t)reduce((uint32_t)e[i * w + j - 1] * (uint32_t)lo[i * w + j]);
+			}
+		}
+	}
+	sim_shares_t flags = slice(&tmp, 0, c);
+	if (simRenormalize(sim, &flags) != 0) goto fail;
+	for (int32_t p = 0; p < NP; p++) {
+		const int32_t *t = tmp.s[p], *lo = lt->s[p];
+		c = 0;
+		for (size_t i = 0; i < n; i++) {
+			uint32_t sum = (uint32_t)lo[i * w];
+			for (uint32_t j = 1; j < w; j++) {
+				sum = reduce(sum + (uint32_t)t[c++]);
+			}
+			out->s[p][i] = (int32_t)sum;
+		}
+	}
+	simRelease(&tmp);
+	return 0;
+
+fail:
+	simRelease(&tmp);
+	return -1;
+}
+
+/*********************************************************************************
+ * @brief Multiply each row of w terms down to one share, like productTree.
+ * @param sim_t *sim: simulator
+ * @param sim_shares_t *terms: n*w shares, overwritten
+ * @param uint32_t w: terms per row
+ * @param sim_shares_t *out: n shares of the row products
+ * @return int: 0 on success, -1 if memory runs out
+ * @note Rounds: ceil(log2(w)). An odd last term carries over to the next level unchanged.
+ *********************************************************************************/
+static int productTree(sim_t *sim, sim_shares_t *terms, uint32_t w, sim_shares_t *out) {
+	const size_t n = out->n;
+	sim_shares_t prod;
+	if (simAlloc(&prod, n * w) != 0) return -1;
+	for (uint32_t len = w; len > 1; len = (len + 1) / 2) {
+		uint32_t half = len / 2, next = (len + 1) / 2;
+		for (int32_t p = 0; p < NP; p++) {
+			const int32_t *t = terms->s[p];
+			int32_t *pr = prod.s[p];
+			for (size_t i = 0; i < n; i++) {
+				for (uint32_t j = 0; j < half; j++) {
+					pr[i * half + j] = (int32_t)reduce((uint32_t)t[i * len + 2 * j] * (uint32_t)t[i * len + 2 * j + 1]);
+				}
+			}
+		}
+		sim_shares_t layer = slice(&prod, 0, n * half);
+		if (simRenormalize(sim, &layer) != 0) {
+			simRelease(&prod);
+			return -1;
+		}
+		for (int32_t p = 0; p < NP; p++) {
+			int32_t *t = terms->s[p];
+			const int32_t *pr = prod.s[p];
+			for (size_t i = 0; i < n; i++) {
+				int32_t carry = t[i * len + len - 1];
+				for (uint32_t j = 0; j < half; j++) {
+					t[i * next + j] = pr[i * half + j];
+				}
+				if (len % 2) t[i * next + half] = carry;
+			}
+		}
+	}
+	for (int32_t p = 0; p < NP; p++) {
+		memcpy(out->s[p], terms->s[p], n * sizeof(int32_t));
+	}
+	simRelease(&prod);
+	return 0;
+}
+
+/*********************************************************************************
+ * @brief Shares of [u_k * v_k] for every bit, in one round, followed by the linear
+ *        per-bit XNOR 1 - u - v + 2uv (into xnor) and, when lt is given, v - uv.
+ *********************************************************************************/
+static int bitProducts(sim_t *sim, const sim_shares_t *u, const sim_shares_t *v, sim_shares_t *xnor, sim_shares_t *lt) {
+	sim_shares_t uv;
+	if (simAlloc(&uv, u->n) != 0) return -1;
+	if (simMul(sim, &uv, u, v) != 0) {
+		simRelease(&uv);
+		return -1;
+	}
+	for (int32_t p = 0; p < NP; p++) {
+		const int32_t *a = u->s[p], *b = v->s[p], *ab = uv.s[p];
+		for (size_t k = 0; k < u->n; k++) {
+			xnor->s[p][k] = (int32_t)reduce((uint32_t)(1 - a[k] - b[k] + 2 * ab[k] + 2 * MOD));
+			if (lt) lt->s[p][k] = (int32_t)reduce((uint32_t)(b[k] - ab[k] + MOD));
+		}
+	}
+	simRelease(&uv);
+	return 0;
+}
+
+/*********************************************************************************
+ * @brief Batched less than, like batchLT: shares of [u < v] for n pairs of w-bit operands.
+ * @param sim_t *sim: simulator
+ * @param const sim_shares_t *u, *v: n*w bit shares each, laid out as simShareBits makes them
+ * @param uint32_t w: bits per operand
+ * @param sim_shares_t *out: n result shares
+ * @return int: 0 on success, -1 if memory runs out
+ * @note Rounds: one for u_j*v_j, then the prefix chain of prefixLT.
+ *********************************************************************************/
+int simLT(sim_t *sim, const sim_shares_t *u, const sim_shares_t *v, uint32_t w, sim_shares_t *out) {
+	sim_shares_t eq = {0}, lt = {0};
+	int status = -1;
+	if (simAlloc(&eq, u->n) == 0 && simAlloc(&lt, u->n) == 0 && bitProducts(sim, u, v, &eq, &lt) == 0) {
+		status = prefixLT(sim, &eq, &lt, w, out);
+	}
+	simRelease(&eq);
+	simRelease(&lt);
+	return status;
+}
+
+/*********************************************************************************
+ * @brief Batched less than against public constants, like batchLTC: shares of [u < c].
+ * @param const int32_t *c: out->n public constants
+ * @note With c_j known, eq_j and lt_j are linear in u_j, so only the prefix chain and
+ *       the final flags need renormalization.
+ *********************************************************************************/
+int simLTPublic(sim_t *sim, const sim_shares_t *u, const int32_t *c, uint32_t w, sim_shares_t *out) {
+	sim_shares_t eq = {0}, lt = {0};
+	int status = -1;
+	if (simAlloc(&eq, u->n) == 0 && simAlloc(&lt, u->n) == 0) {
+		for (int32_t p = 0; p < NP; p++) {
+			for (size_t i = 0; i < out->n; i++) {
+				for (uint32_t j = 0; j < w; j++) {
+					size_t k = i * w + j;
+					int32_t cj = (c[i] >> (w - 1 - j)) & 1, b = u->s[p][k];
+					eq.s[p][k] = cj ? b : (int32_t)reduce((uint32_t)(1 - b + MOD));
+					lt.s[p][k] = cj ? (int32_t)reduce((uint32_t)(1 - b + MOD)) : 0;
+				}
+			}
+		}
+		status = prefixLT(sim, &eq, &lt, w, out);
+	}
+	simRelease(&eq);
+	simRelease(&lt);
+	return status;
+}
+
+/*********************************************************************************
+ * @brief Batched equality, like batchEQ: shares of [u == v] for n pairs of w-bit operands.
+ * @note Rounds: one for u_j*v_j, then ceil(log2(w)) for a product tree over the XNORs.
+ *********************************************************************************/
+int simEQ(sim_t *sim, const sim_shares_t *u, const sim_shares_t *v, uint32_t w, sim_shares_t *out) {
+	sim_shares_t terms;
+	int status = -1;
+	if (simAlloc(&terms, u->n) != 0) return -1;
+	if (bitProducts(sim, u, v, &terms, NULL) == 0) {
+		status = productTree(sim, &terms, w, out);
+	}
+	simRelease(&terms);
+	return status;
+}
+
+/*********************************************************************************
+ * @brief Batched equality against public constants, like batchEQC: shares of [u == c].
+ * @note The per-bit XNORs are linear, so only the product tree needs renormalization.
+ *********************************************************************************/
+int simEQPublic(sim_t *sim, const sim_shares_t *u, const int32_t *c, uint32_t w, sim_shares_t *out) {
+	sim_shares_t terms;
+	int status;
+	if (simAlloc(&terms, u->n) != 0) return -1;
+	for (int32_t p = 0; p < NP; p++) {
+		for (size_t i = 0; i < out->n; i++) {
+			for (uint32_t j = 0; j < w; j++) {
+				size_t k = i * w + j;
+				int32_t b = u->s[p][k];
+				terms.s[p][k] = ((c[i] >> (w - 1 - j)) & 1) ? b : (int32_t)reduce((uint32_t)(1 - b + MOD));
+			}
+		}
+	}
+	status = productTree(sim, &terms, w, out);
+	simRelease(&terms);
+	return status;
+}
+
+static int32_t powMod(int32_t base, int32_t e) {
+	int64_t result = 1, b = base % MOD;
+	while (e > 0) {
+		if (e & 1) result = result * b % MOD;
+		b = b * b % MOD;
+		e >>= 1;
+	}
+	return (int32_t)result;
+}
+
+/*********************************************************************************
+ * @brief Deal count zero-test masks of degree D, the way netint-dealer does.
+ * Mask k of party p is D + 2 values at masks->s[p] + k * (D + 2): [m], [m^-1] ... [m^-D],
+ * and a degree-2 sharing of zero.
+ * @return int: 0 on success, -1 if memory runs out
+ *********************************************************************************/
+static int dealMasks(sim_t *sim, size_t count, uint32_t D, sim_shares_t *masks) {
+	const size_t stride = D + 2;
+	int32_t *r = malloc((stride + 2) * sizeof(int32_t));
+	if (!r || simAlloc(masks, count * stride) != 0) {
+		free(r);
+		return -1;
+	}
+	for (size_t k = 0; k < count; k++) {
+		simRandom(sim, r, stride + 2);
+		int32_t m = r[0] % (MOD - 1) + 1;
+		int64_t mInv = powMod(m, MOD - 2), power = m;
+		for (uint32_t i = 0; i <= D; i++) {
+			for (int32_t p = 0; p < NP; p++) {
+				masks->s[p][k * stride + i] = (int32_t)(((p + 1) * (int64_t)r[1 + i] + power) % MOD);
+			}
+			power = (i == 0 ? mInv : power * mInv % MOD);
+		}
+		int64_t a1 = r[stride], a2 = r[stride + 1];
+		for (int32_t p = 0; p < NP; p++) {
+			masks->s[p][k * stride + D + 1] = (int32_t)((a1 * (p + 1) + a2 * (p + 1) * (p + 1)) % MOD);
+		}
+	}
+	sim->stats.masks += count;
+	free(r);
+	return 0;
+}
+
+/*********************************************************************************
+ * @brief Constant-round zero test on values known to lie in [0, D], like zeroTest.
+ * The simulator deals its own masks, which costs no rounds, as the dealer runs offline.
+ * @param sim_t *sim: simulator
+ * @param const sim_shares_t *y: shares to test
+ * @param uint32_t D: largest possible value
+ * @param sim_shares_t *out: y->n shares of [y == 0], may alias y
+ * @return int: 0 on success, -1 if memory runs out
+ * @note One round: e = (y + 1) * m is opened. Then [(y + 1)^i] = e^i * [m^-i] is local, and
+ *       the polynomial that is 1 at y + 1 = 1 and 0 at 2 ... D + 1 gives the result.
+ *********************************************************************************/
+int simZeroTest(sim_t *sim, const sim_shares_t *y, uint32_t D, sim_shares_t *out) {
+	const size_t count = y->n, stride = D + 2;
+	sim_shares_t masks = {0}, e = {0};
+	int32_t *opened = malloc((count ? count : 1) * sizeof(int32_t));
+	int64_t *alpha = malloc((D + 1) * sizeof(int64_t));
+	int status = -1;
+	if (!opened || !alpha || dealMasks(sim, count, D, &masks) != 0 || simAlloc(&e, count) != 0) goto done;
+
+	for (int32_t p = 0; p < NP; p++) {
+		const int32_t *mk = masks.s[p], *yp = y->s[p];
+		for (size_t k = 0; k < count; k++) {
+			uint32_t y1 = reduce((uint32_t)yp[k] + 1);
+			e.s[p][k] = (int32_t)reduce(y1 * (uint32_t)mk[k * stride] + (uint32_t)mk[k * stride + D + 1]);
+		}
+	}
+	simOpen(sim, &e, opened);
+
+	// alpha = coefficients of prod_{t=2}^{D+1} (x - t) / (1 - t)
+	memset(alpha, 0, (D + 1) * sizeof(int64_t));
+	alpha[0] = 1;
+	for (uint32_t t = 2; t <= D + 1; t++) {
+		int64_t scale = powMod((int32_t)((1 - (int32_t)t + MOD) % MOD), MOD - 2);
+		for (uint32_t i = t - 1; i > 0; i--) {
+			alpha[i] = (alpha[i - 1] + alpha[i] * (MOD - t)) % MOD;
+		}
+		alpha[0] = alpha[0] * (MOD - t) % MOD;
+		for (uint32_t i = 0; i < t; i++) {
+			alpha[i] = alpha[i] * scale % MOD;
+		}
+	}
+
+	for (int32_t p = 0; p < NP; p++) {
+		const int32_t *mk = masks.s[p];
+		for (size_t k = 0; k < count; k++) {
+			int64_t acc = alpha[0], ePow = 1;
+			for (uint32_t i = 1; i <= D; i++) {
+				ePow = ePow * opened[k] % MOD;
+				acc = (acc + alpha[i] * (ePow * mk[k * stride + i] % MOD)) % MOD;
+			}
+			out->s[p][k] = (int32_t)acc;
+		}
+	}
+	status = 0;
+
+done:
+	free(opened);
+	free(alpha);
+	simRelease(&masks);
+	simRelease(&e);
+	return status;
+}
+
+/*********************************************************************************
+ * @brief Turn per-bit difference indicators into "first difference" flags, like
+ *        firstDifference: every prefix sum is zero-tested in the same round.
+ * @param sim_shares_t *x: n*w shares of [bit j differs], replaced by the flags
+ *********************************************************************************/
+static int firstDifference(sim_t *sim, sim_shares_t *x, size_t n, uint32_t w) {
+	for (int32_t p = 0; p < NP; p++) {
+		int32_t *xp = x->s[p];
+		for (size_t i = 0; i < n; i++) {
+			uint32_t run = 0;
+			for (uint32_t j = 0; j < w; j++) {
+				run = reduce(run + (uint32_t)xp[i * w + j]);
+				xp[i * w + j] = (int32_t)run;
+			}
+		}
+	}
+	if (simZeroTest(sim, x, w, x) != 0) return -1;
+	// prefixOr_j = 1 - [sum_j == 0], first_j = prefixOr_j - prefixOr_{j-1}
+	for (int32_t p = 0; p < NP; p++) {
+		int32_t *xp = x->s[p];
+		for (size_t i = 0; i < n; i++) {
+			uint32_t prevOr = 0;
+			for (uint32_t j = 0; j < w; j++) {
+				uint32_t prefixOr = reduce((uint32_t)(1 - xp[i * w + j] + MOD));
+				xp[i * w + j] = (int32_t)reduce(prefixOr - prevOr + MOD);
+				prevOr = prefixOr;
+			}
+		}
+	}
+	return 0;
+}
+
+/*********************************************************************************
+ * @brief Per-bit XOR u + v - 2uv of two shared bit vectors, in one round.
+ *********************************************************************************/
+static int sharedXor(sim_t *sim, const sim_shares_t *u, const sim_shares_t *v, sim_shares_t *x) {
+	if (simMul(sim, x, u, v) != 0) return -1;
+	for (int32_t p = 0; p < NP; p++) {
+		const int32_t *a = u->s[p], *b = v->s[p];
+		int32_t *xp = x->s[p];
+		for (size_t k = 0; k < x->n; k++) {
+			xp[k] = (int32_t)reduce((uint32_t)(a[k] + b[k] - 2 * xp[k] + 2 * MOD));
+		}
+	}
+	return 0;
+}
+
+/*********************************************************************************
+ * @brief Per-bit XOR of shared bits with public constants, which is linear.
+ *********************************************************************************/
+static void publicXor(const sim_shares_t *u, const int32_t *c, size_t n, uint32_t w, sim_shares_t *x) {
+	for (int32_t p = 0; p < NP; p++) {
+		for (size_t i = 0; i < n; i++) {
+			for (uint32_t j = 0; j < w; j++) {
+				size_t k = i * w + j;
+				int32_t b = u->s[p][k];
+				x->s[p][k] = ((c[i] >> (w - 1 - j)) & 1) ? (int32_t)reduce((uint32_t)(1 - b + MOD)) : b;
+			}
+		}
+	}
+}
+
+/*********************************************************************************
+ * @brief Constant-round less than with preprocessed masks, like batchLTPre.
+ * @note Rounds: XOR products, one zero-test opening, first-difference times v_j.
+ *********************************************************************************/
+int simLTPre(sim_t *sim, const sim_shares_t *u, const sim_shares_t *v, uint32_t w, sim_shares_t *out) {
+	sim_shares_t x;
+	int status = -1;
+	if (simAlloc(&x, u->n) != 0) return -1;
+	if (sharedXor(sim, u, v, &x) == 0 && firstDifference(sim, &x, out->n, w) == 0 && simMul(sim, &x, &x, v) == 0) {
+		for (int32_t p = 0; p < NP; p++) {
+			for (size_t i = 0; i < out->n; i++) {
+				uint32_t sum = 0;
+				for (uint32_t j = 0; j < w; j++) {
+					sum = reduce(sum + (uint32_t)x.s[p][i * w + j]);
+				}
+				out->s[p][i] = (int32_t)sum;
+			}
+		}
+		status = 0;
+	}
+	simRelease(&x);
+	return status;
+}
+
+/*********************************************************************************
+ * @brief Constant-round less than against public constants, like batchLTCPre.
+ * @note One round: the XORs and the final selection of c_j are linear.
+ *********************************************************************************/
+int simLTPublicPre(sim_t *sim, const sim_shares_t *u, const int32_t *c, uint32_t w, sim_shares_t *out) {
+	sim_shares_t x;
+	int status = -1;
+	if (simAlloc(&x, u->n) != 0) return -1;
+	publicXor(u, c, out->n, w, &x);
+	if (firstDifference(sim, &x, out->n, w) == 0) {
+		for (int32_t p = 0; p < NP; p++) {
+			for (size_t i = 0; i < out->n; i++) {
+				uint32_t sum = 0;
+				for (uint32_t j = 0; j < w; j++) {
+					if ((c[i] >> (w - 1 - j)) & 1) sum = reduce(sum + (uint32_t)x.s[p][i * w + j]);
+				}
+				out->s[p][i] = (int32_t)sum;
+			}
+		}
+		status = 0;
+	}
+	simRelease(&x);
+	return status;
+}
+
+/*********************************************************************************
+ * @brief Sum each row of w per-bit shares and zero-test the sums, which counts the differing
+ *        bits of each comparison.
+ *********************************************************************************/
+static int zeroTestRows(sim_t *sim, sim_shares_t *x, uint32_t w, sim_shares_t *out) {
+	sim_shares_t diff;
+	int status;
+	if (simAlloc(&diff, out->n) != 0) return -1;
+	for (int32_t p = 0; p < NP; p++) {
+		for (size_t i = 0; i < out->n; i++) {
+			uint32_t sum = 0;
+			for (uint32_t j = 0; j < w; j++) {
+				sum = reduce(sum + (uint32_t)x->s[p][i * w + j]);
+			}
+			diff.s[p][i] = (int32_t)sum;
+		}
+	}
+	status = simZeroTest(sim, &diff, w, out);
+	simRelease(&diff);
+	return status;
+}
+
+/*********************************************************************************
+ * @brief Constant-round equality with preprocessed masks, like batchEQPre.
+ * @note Rounds: XOR products and one zero-test opening of the number of differing bits.
+ *********************************************************************************/
+int simEQPre(sim_t *sim, const sim_shares_t *u, const sim_shares_t *v, uint32_t w, sim_shares_t *out) {
+	sim_shares_t x;
+	int status = -1;
+	if (simAlloc(&x, u->n) != 0) return -1;
+	if (sharedXor(sim, u, v, &x) == 0) status = zeroTestRows(sim, &x, w, out);
+	simRelease(&x);
+	return status;
+}
+
+/*********************************************************************************
+ * @brief Constant-round equality against public constants, like batchEQCPre.
+ * @note One round: the zero-test opening.
+ *********************************************************************************/
+int simEQPublicPre(sim_t *sim, const sim_shares_t *u, const int32_t *c, uint32_t w, sim_shares_t *out) {
+	sim_shares_t x;
+	int status;
+	if (simAlloc(&x, u->n) != 0) return -1;
+	publicXor(u, c, out->n, w, &x);
+	status = zeroTestRows(sim, &x, w, out);
+	simRelease(&x);
+	return status;
+}
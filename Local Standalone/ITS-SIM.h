@@ -0,0 +1,86 @@
+// ITS-SIM.h
+
+#ifndef ITS_SIM_H
+#define ITS_SIM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "ITS-MPC.h"
+
+/*********************************************************************************
+ * @brief In-memory simulator that runs batched protocols for all three parties in one process.
+ * Sharing, multiplication and renormalization are the arithmetic of ITS-MPC.c, applied to
+ * whole batches. The comparison kernels mirror the batched ones in agent.c: simLT, simEQ and
+ * their public-constant and preprocessed variants run the same layers in the same order, and
+ * simCompare keeps the baseline CompareParallelTest for reference. Shares are stored
+ * struct-of-arrays: party j's shares of a batch are one contiguous array, so every step is a
+ * straight loop over int32 lanes that the compiler vectorizes. Randomness comes from a seeded
+ * counter-based generator, so a failing property test replays exactly from its seed. It is
+ * meant for testing and benchmarking, not for keeping secrets.
+ *
+ * The simulator counts what the networked agents would do: interaction rounds, renormalized
+ * values, opened values and dealer masks. A protocol change can then be checked and measured
+ * here before it goes into agent.c.
+ *********************************************************************************/
+#define SIM_ALIGN 64
+
+/*********************************************************************************
+ * @brief Shares of a batch of n secrets, one aligned array per party.
+ *********************************************************************************/
+typedef struct {
+	size_t n;
+	int32_t *s[NP]; /* s[j][i]: party j's share of secret i */
+} sim_shares_t;
+
+typedef struct {
+	uint64_t rounds;       /* Interactive layers: one renormalization or opening of a batch */
+	uint64_t renormalized; /* Values renormalized */
+	uint64_t opened;       /* Values reconstructed inside a protocol */
+	uint64_t masks;        /* Zero-test masks dealt for the preprocessed comparisons */
+} sim_stats_t;
+
+typedef struct {
+	uint64_t seed;
+	uint64_t counter; /* Random values drawn so far */
+	int32_t *scratch; /* Random coefficients for renormalization and sharing */
+	size_t scratchLen;
+	sim_stats_t stats;
+} sim_t;
+
+int simInit(sim_t *sim, uint64_t seed);
+void simFree(sim_t *sim);
+void simResetStats(sim_t *sim);
+
+int simAlloc(sim_shares_t *x, size_t n);
+void simRelease(sim_shares_t *x);
+
+void simRandom(sim_t *sim, int32_t *out, size_t n);
+int simSplit(sim_t *sim, sim_shares_t *x, const int32_t *secrets);
+void simReconstruct(const sim_shares_t *x, int32_t *secrets);
+
+void simAdd(sim_shares_t *z, const sim_shares_t *x, const sim_shares_t *y);
+void simSub(sim_shares_t *z, const sim_shares_t *x, const sim_shares_t *y);
+void simAddPublic(sim_shares_t *z, const sim_shares_t *x, int32_t c);
+void simScale(sim_shares_t *z, const sim_shares_t *x, int32_t c);
+void simMulLocal(sim_shares_t *z, const sim_shares_t *x, const sim_shares_t *y);
+int simRenormalize(sim_t *sim, sim_shares_t *x);
+int simMul(sim_t *sim, sim_shares_t *z, const sim_shares_t *x, const sim_shares_t *y);
+
+int simCompare(sim_t *sim, const int32_t *u, const int32_t *v, size_t n, int32_t *c, int32_t *e);
+
+// Comparisons as agent.c runs them: operands are n*w bit shares, bit j of operand i at
+// i*w + j, MSB first, and out holds n result shares
+int simShareBits(sim_t *sim, const int32_t *values, size_t n, uint32_t w, sim_shares_t *bits);
+void simOpen(sim_t *sim, const sim_shares_t *x, int32_t *values);
+int simLT(sim_t *sim, const sim_shares_t *u, const sim_shares_t *v, uint32_t w, sim_shares_t *out);
+int simLTPublic(sim_t *sim, const sim_shares_t *u, const int32_t *c, uint32_t w, sim_shares_t *out);
+int simEQ(sim_t *sim, const sim_shares_t *u, const sim_shares_t *v, uint32_t w, sim_shares_t *out);
+int simEQPublic(sim_t *sim, const sim_shares_t *u, const int32_t *c, uint32_t w, sim_shares_t *out);
+int simZeroTest(sim_t *sim, const sim_shares_t *y, uint32_t D, sim_shares_t *out);
+int simLTPre(sim_t *sim, const sim_shares_t *u, const sim_shares_t *v, uint32_t w, sim_shares_t *out);
+int simLTPublicPre(sim_t *sim, const sim_shares_t *u, const int32_t *c, uint32_t w, sim_shares_t *out);
+int simEQPre(sim_t *sim, const sim_shares_t *u, const sim_shares_t *v, uint32_t w, sim_shares_t *out);
+int simEQPublicPre(sim_t *sim, const sim_shares_t *u, const int32_t *c, uint32_t w, sim_shares_t *out);
+
+#endif // ITS_SIM_H
@@ -1,16 +1,34 @@
 #ifndef NETINT_H
 #define NETINT_H
 
+#include <algorithm>
 #include <arpa/inet.h>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
 #include <cstdint>
+#include <cstdio>
 #include <cstdlib>
 #include <cstring>
 #include <ctime>
+#include <deque>
+#include <fcntl.h>
+#include <future>
 #include <iostream>
+#include <map>
 #include <memory>
+#include <mutex>
 #include <netdb.h>
+#include <optional>
+#include <poll.h>
 #include <stdexcept>
+#include <sys/mman.h>
 #include <sys/socket.h>
+#include <sys/stat.h>
+#include <thread>
+#include <tuple>
+#include <type_traits>
 #include <unistd.h>
 #include <vector>
 
@@ -32,8 +50,42 @@ namespace detail {
 		OP_MUL = 0x02,
 		OP_CMP = 0x03,
 		OP_EQL = 0x04,
+		OP_LT = 0x05,
+		OP_DOT = 0x06,
+		OP_LTC = 0x07,
+		OP_EQC = 0x08,
+		OP_STORE = 0x10,
+		OP_PRE = 0x20,
+		OP_BATCH = 0x40,
 		OP_REN = 0x80,
-		OP_RES = 0x81
+		OP_RES = 0x81,
+		OP_OPN = 0x82,
+		OP_MESH = 0x83,
+		OP_KEEP = 0x84
+	};
+
+	/*********************************************************************************
+	 * @brief Protocol used for secret comparisons.
+	 * Bitwise runs the prefix-product circuits, whose rounds grow with log2 of the width.
+	 * Preprocessed spends precomputed random masks to finish in a constant number of rounds.
+	 * Dealer runs the same protocol with masks the agents read from netint-dealer stores.
+	 *********************************************************************************/
+	enum class CompareBackend {
+		Bitwise,
+		Preprocessed,
+		Dealer
+	};
+
+	/*********************************************************************************
+	 * @brief How results are collected when one agent answers late.
+	 * Wait reads all three shares in order. Check and Discard reconstruct degree-1 results
+	 * from the first two agents to answer. Check verifies the late share against them once it
+	 * arrives, and Discard reads the late share and drops it.
+	 *********************************************************************************/
+	enum class StragglerPolicy {
+		Wait,
+		Check,
+		Discard
 	};
 
 	struct __attribute__((packed)) task_t {
@@ -49,6 +101,147 @@ namespace detail {
 		uint32_t value;
 	};
 
+	/*********************************************************************************
+	 * @brief Header of a batched frame. Followed by count 32-bit values in network byte order.
+	 * @note op carries OP_BATCH. width is the bit width of comparison operands, and its high
+	 *       bit (WIDTH_SUM) asks the agents to return the sum of all outputs as one value.
+	 *       With WIDTH_PACKED the values are packed four to seven bytes instead, see
+	 *       packValues, and the agents answer and exchange that task's shares packed too.
+	 *********************************************************************************/
+	const uint8_t WIDTH_SUM = 0x80;
+	const uint8_t WIDTH_PACKED = 0x40; // Values packed at PACK_BITS each, in every frame of the task
+	const int PACK_BITS = 14;          // ceil(log2(MOD))
+	struct __attribute__((packed)) frame_t {
+		uint8_t op;
+		uint32_t count;
+		uint8_t width;
+	};
+
+	/*********************************************************************************
+	 * @brief Layout of a protocol transcript, the same as transcript.h on the agent side.
+	 * A header, then one record per send or receive followed by the bytes on the wire.
+	 * The primary records agent k as connection k.
+	 *********************************************************************************/
+	const char TRANSCRIPT_MAGIC[8] = {'N', 'I', 'T', 'R', 'A', 'C', 'E', '1'};
+	enum { TRANSCRIPT_SENT = 0, TRANSCRIPT_RECEIVED = 1 };
+	enum { TRANSCRIPT_PRIMARY = 0, TRANSCRIPT_AGENT = 1 };
+
+	struct TranscriptHeader {
+		char magic[8];
+		uint32_t role;
+		uint32_t reserved;
+		uint64_t startNs;
+		uint64_t reserved2;
+	};
+
+	struct TranscriptRecord {
+		uint64_t ns;
+		uint32_t len;
+		uint8_t dir;
+		uint8_t conn;
+		uint16_t pad;
+	};
+	static_assert(sizeof(TranscriptHeader) == 32 && sizeof(TranscriptRecord) == 16, "transcript layout is shared with the agent");
+
+	/*********************************************************************************
+	 * @brief Bytes taken by count packed values.
+	 *********************************************************************************/
+	inline size_t packedSize(size_t count) {
+		return (count * PACK_BITS + 7) / 8;
+	}
+
+	/*********************************************************************************
+	 * @brief Pack values below 2^PACK_BITS, least significant bits first, as agent.c does.
+	 * @param const int32_t *values: values to pack
+	 * @param size_t count: number of values
+	 * @param uint8_t *out: packedSize(count) bytes
+	 * @note Four values fill exactly seven bytes, so each group is assembled in one 64-bit
+	 *       word and written out byte by byte. This is plain scalar code.
+	 *********************************************************************************/
+	inline void packValues(const int32_t *values, size_t count, uint8_t *out) {
+		size_t i = 0;
+		for (; i + 4 <= count; i += 4, out += 7) {
+			uint64_t word = static_cast<uint64_t>(values[i]) | static_cast<uint64_t>(values[i + 1]) << 14 | static_cast<uint64_t>(values[i + 2]) << 28 | static_cast<uint64_t>(values[i + 3]) << 42;
+			for (int b = 0; b < 7; b++) {
+				out[b] = static_cast<uint8_t>(word >> (8 * b));
+			}
+		}
+		uint64_t word = 0;
+		for (size_t k = 0; i + k < count; k++) {
+			word |= static_cast<uint64_t>(values[i + k]) << (PACK_BITS * k);
+		}
+		for (size_t b = 0; b < packedSize(count - i); b++) {
+			out[b] = static_cast<uint8_t>(word >> (8 * b));
+		}
+	}
+
+	/*********************************************************************************
+	 * @brief Unpack values written by packValues.
+	 * @param const uint8_t *in: packedSize(count) bytes
+	 * @param size_t count: number of values
+	 * @param int32_t *values: destination
+	 *********************************************************************************/
+	inline void unpackValues(const uint8_t *in, size_t count, int32_t *values) {
+		const uint64_t mask = (1u << PACK_BITS) - 1;
+		size_t i = 0;
+		for (; i + 4 <= count; i += 4, in += 7) {
+			uint64_t word = 0;
+			for (int b = 0; b < 7; b++) {
+				word |= static_cast<uint64_t>(in[b]) << (8 * b);
+			}
+			values[i] = static_cast<int32_t>(word & mask);
+			values[i + 1] = static_cast<int32_t>(word >> 14 & mask);
+			values[i + 2] = static_cast<int32_t>(word >> 28 & mask);
+			values[i + 3] = static_cast<int32_t>(word >> 42 & mask);
+		}
+		uint64_t word = 0;
+		for (size_t b = 0; b < packedSize(count - i); b++) {
+			word |= static_cast<uint64_t>(in[b]) << (8 * b);
+		}
+		for (size_t k = 0; i + k < count; k++) {
+			values[i + k] = static_cast<int32_t>(word >> (PACK_BITS * k) & mask);
+		}
+	}
+
+	/*********************************************************************************
+	 * @brief Traffic one agent would see, counted by a simulated run.
+	 * The three agents are symmetric, so the counts hold for each of them. A round is one
+	 * network round trip the agents wait on: the task itself, then every renormalization or
+	 * opening layer. Messages and bytes count what the agent sends and receives.
+	 *********************************************************************************/
+	struct CostCounters {
+		uint64_t tasks = 0;
+		uint64_t rounds = 0;
+		uint64_t messages = 0;
+		uint64_t bytes = 0;
+
+		CostCounters &operator+=(const CostCounters &other) {
+			tasks += other.tasks;
+			rounds += other.rounds;
+			messages += other.messages;
+			bytes += other.bytes;
+			return *this;
+		}
+
+		/*********************************************************************************
+		 * @brief Wall time on a network with the given latency and bandwidth, ignoring compute.
+		 * @param double roundTripSeconds: time of one round trip
+		 * @param double bytesPerSecond: link bandwidth of one agent
+		 *********************************************************************************/
+		double estimatedSeconds(double roundTripSeconds, double bytesPerSecond) const {
+			return rounds * roundTripSeconds + bytes / bytesPerSecond;
+		}
+	};
+
+	/*********************************************************************************
+	 * @brief Simulated cost of one kind of operation under one call site.
+	 *********************************************************************************/
+	struct CostEntry {
+		std::string site; // Enclosing CostScope labels joined with '/', empty outside any
+		std::string op;   // Operation, with the comparison width where it matters
+		CostCounters cost;
+	};
+
 	class NetIntContext {
 	private:
 		/*********************************************************************************
@@ -63,6 +256,67 @@ namespace detail {
 		bool useWhitelist = false;
 		bool showMessages = true;
 
+		/*********************************************************************************
+		 * @brief Precomputed zero-test masks of one degree, stored as per-agent shares.
+		 *********************************************************************************/
+		struct MaskPool {
+			std::vector<int32_t> shares[3];
+			size_t next = 0; // Masks already handed out
+		};
+		CompareBackend compareBackend = CompareBackend::Bitwise;
+		MaskPool maskPools[l + 1]; // Indexed by degree, which is the comparison width
+
+		/*********************************************************************************
+		 * @brief A result an agent still owes after the other two already answered.
+		 *********************************************************************************/
+		struct LateShares {
+			bool batch;                    // Batched frame, or a single response_t
+			std::vector<int32_t> expected; // Shares the agent must send, empty when discarding
+		};
+		StragglerPolicy stragglerPolicy = StragglerPolicy::Wait;
+		std::deque<LateShares> late[3];
+
+		std::vector<char> frameBuffer; // Reused by sendFrame
+		bool packFrames = true;
+
+		FILE *transcript = nullptr; // Recording, when set
+		uint64_t transcriptStart = 0;
+		const char *replayBase = nullptr; // Mapped transcript, when replaying
+		size_t replaySize = 0;
+		size_t replayPos[4] = {}, replayUsed[4] = {}; // Read cursor per agent
+
+		bool meshEnabled = true;
+		bool meshActive = false; // Agents renormalize and open among themselves
+		int meshPorts[3] = {0, 0, 0};
+
+		uint32_t keptRows = 0, keptCols = 0; // Shape of the matrix the agents keep for OP_DOT | OP_STORE
+		std::vector<int32_t> keptValues;     // Its values, for simulated runs only
+
+		/*********************************************************************************
+		 * @brief A single operation waiting for the auto-batcher, and the caller's result.
+		 *********************************************************************************/
+		enum class Queued { Mul, LT, EQ, LTPublic, EQPublic };
+		struct QueuedOp {
+			Queued kind;
+			int width;
+			int32_t a, b;
+			std::promise<int32_t> result;
+			std::chrono::steady_clock::time_point queued;
+			std::string site; // Caller's CostScope, charged when the batch runs
+		};
+		mutable std::mutex wire; // Held while a task's shares are dealt and exchanged, and while costs change
+		std::atomic<bool> batching{false};
+		bool stopBatching = false;
+		size_t batchSize = 0, maxPending = 0;
+		std::chrono::microseconds batchWindow{0};
+		std::mutex queueLock; // Guards the queue and the settings above
+		std::condition_variable queueReady, queueSpace;
+		std::deque<QueuedOp> queue;
+		std::thread batcher;
+
+		bool simulated = false; // Results computed here, agent traffic only counted
+		std::map<std::pair<std::string, std::string>, CostCounters> costs; // Guarded by wire
+
 		NetIntContext() {
 			srand(static_cast<unsigned>(time(nullptr)));
 		}
@@ -91,23 +345,89 @@ namespace detail {
 			return "unknown";
 		}
 
+		static uint64_t nowNs() {
+			struct timespec ts;
+			clock_gettime(CLOCK_MONOTONIC, &ts);
+			return static_cast<uint64_t>(ts.tv_sec) * 1000000000u + static_cast<uint64_t>(ts.tv_nsec);
+		}
+
+		/*********************************************************************************
+		 * @brief Transcript connection of an agent socket: 1..3, or -1 for other sockets.
+		 *********************************************************************************/
+		int connOf(int fd) const {
+			for (int i = 0; i < 3; i++) {
+				if (cli[i] == fd) return i + 1;
+			}
+			return -1;
+		}
+
+		void record(uint8_t dir, int conn, const void *buf, size_t len) {
+			if (!transcript || conn < 0 || len == 0) return;
+			TranscriptRecord rec = {nowNs() - transcriptStart, static_cast<uint32_t>(len), dir, static_cast<uint8_t>(conn), 0};
+			fwrite(&rec, sizeof(rec), 1, transcript);
+			fwrite(buf, 1, len, transcript);
+		}
+
+		/*********************************************************************************
+		 * @brief Copy the next bytes an agent sent in the replayed transcript.
+		 * @return size_t: bytes copied, less than len once the agent's recording ends
+		 *********************************************************************************/
+		size_t replayRead(int conn, void *buf, size_t len) {
+			size_t got = 0;
+			while (got < len) {
+				size_t pos = replayPos[conn];
+				TranscriptRecord rec;
+				if (pos + sizeof(rec) > replaySize) break;
+				memcpy(&rec, replayBase + pos, sizeof(rec));
+				if (pos + sizeof(rec) + rec.len > replaySize) break;
+				if (rec.dir != TRANSCRIPT_RECEIVED || rec.conn != conn || replayUsed[conn] == rec.len) {
+					replayPos[conn] = pos + sizeof(rec) + rec.len;
+					replayUsed[conn] = 0;
+					continue;
+				}
+				size_t n = std::min<size_t>(rec.len - replayUsed[conn], len - got);
+				memcpy(static_cast<char *>(buf) + got, replayBase + pos + sizeof(rec) + replayUsed[conn], n);
+				replayUsed[conn] += n;
+				got += n;
+			}
+			return got;
+		}
+
 		/*********************************************************************************
 		 * @brief Receive all bytes from a socket until the specified length is reached.
 		 * @param int fd: file descriptor of the socket
 		 * @param void *buf: buffer to store received data
 		 * @param size_t len: number of bytes to receive
 		 * @return ssize_t: number of bytes received, or -1 on error
+		 * @note When replaying, the bytes come from the transcript instead.
 		 *********************************************************************************/
 		ssize_t recvAll(int fd, void *buf, size_t len) {
+			if (replayBase) {
+				int conn = connOf(fd);
+				return conn < 0 ? -1 : static_cast<ssize_t>(replayRead(conn, buf, len));
+			}
 			size_t got = 0;
 			while (got < len) {
 				ssize_t r = recv(fd, static_cast<char *>(buf) + got, len - got, 0);
 				if (r <= 0) return r;
 				got += r;
 			}
+			record(TRANSCRIPT_RECEIVED, connOf(fd), buf, got);
 			return got;
 		}
 
+		/*********************************************************************************
+		 * @brief Send a buffer to an agent, recording it if a transcript is open.
+		 * @return ssize_t: number of bytes sent, or -1 on error
+		 * @note When replaying, nothing is sent.
+		 *********************************************************************************/
+		ssize_t sendAll(int fd, const void *buf, size_t len) {
+			if (replayBase) return static_cast<ssize_t>(len);
+			ssize_t sent = send(fd, buf, len, 0);
+			if (sent > 0) record(TRANSCRIPT_SENT, connOf(fd), buf, static_cast<size_t>(sent));
+			return sent;
+		}
+
 		/*********************************************************************************
 		 * @brief Bind to a service and listen for incoming connections.
 		 * @param const char *service: service name or port number
@@ -152,6 +472,31 @@ namespace detail {
 			return s;
 		}
 
+		/*********************************************************************************
+		 * @brief Read an agent's join line.
+		 * @param int cfd: agent socket
+		 * @param int &meshPort: receives the port the agent accepts other agents on, 0 if none
+		 * @return int: 0 for "JOIN", the requested slot 1..3 for "JOIN <k>", or -1 if invalid
+		 * @note Agents that hold stored shares ask for the slot of the party they belong to,
+		 *       others send "JOIN 0 <port>" when they only announce a mesh port.
+		 *********************************************************************************/
+		int readJoin(int cfd, int &meshPort) {
+			char buf[32];
+			size_t len = 0;
+			meshPort = 0;
+			while (len < sizeof(buf) - 1) {
+				if (recv(cfd, buf + len, 1, 0) != 1) return -1;
+				if (buf[len++] == '\n') break;
+			}
+			buf[len] = '\0';
+			if (strcmp(buf, JOIN_MSG) == 0) return 0;
+			int slot = -1, port = 0, end = 0;
+			if (sscanf(buf, "JOIN %d%n %d%n", &slot, &end, &port, &end) < 1 || buf[end] != '\n' || buf[end + 1] != '\0') return -1;
+			if (slot < 0 || slot > 3 || port < 0 || port > 65535) return -1;
+			meshPort = port;
+			return slot;
+		}
+
 		/*********************************************************************************
 		 * @brief Reconstruct secret from shares using gamma coefficients.
 		 * @param int32_t shares[]: array of shares
@@ -219,6 +564,7 @@ namespace detail {
 		void waitRenorm() {
 			int32_t resultShares[3];
 			for (int i = 0; i < 3; ++i) {
+				settleLate(i);
 				response_t r;
 				if (recvAll(cli[i], &r, sizeof(r)) != sizeof(r)) {
 					throw std::runtime_error("Client disconnected during RENORM");
@@ -231,523 +577,3425 @@ namespace detail {
 			renormalize(resultShares);
 			for (int i = 0; i < 3; ++i) {
 				response_t r = {OP_REN, htonl(static_cast<uint32_t>(resultShares[i]))};
-				if (send(cli[i], &r, sizeof(r), 0) != sizeof(r)) {
+				if (sendAll(cli[i], &r, sizeof(r)) != sizeof(r)) {
 					throw std::runtime_error("Send failed during RENORM");
 				}
 			}
 		}
 
 		/*********************************************************************************
-		 * @brief Run a comparison operation with the MPC protocol.
-		 * @param int32_t u: first operand
-		 * @param int32_t v: second operand
-		 * @return int32_t: result of the comparison
+		 * @brief Send a batched frame to one agent.
+		 * @param int fd: agent socket
+		 * @param uint8_t op: opcode including OP_BATCH
+		 * @param uint8_t width: bit width of comparison operands
+		 * @param const std::vector<int32_t> &values: payload values
 		 *********************************************************************************/
-		int32_t runCMP(int32_t u, int32_t v) {
-			if (!initialized) throw std::logic_error("MPC context not initialized, need to add the following line before using a NetInt operation:\nestablishPort(\"1234567\");");
-			int32_t bits_u[l] = {0};
-			int32_t bits_v[l] = {0};
-			int32_t uShares[3][l];
-			int32_t vShares[3][l];
-
-			for (int32_t i = 0; i < l; i++) {
-				bits_u[i] = (u >> (l - 1 - i)) & 1;
-				bits_v[i] = (v >> (l - 1 - i)) & 1;
-			}
-
-			for (int32_t i = 0; i < l; i++) {
-				int32_t ru = rand() % MOD;
-				int32_t rv = rand() % MOD;
-				for (int j = 0; j < 3; j++) {
-					uShares[j][i] = split(j, ru, bits_u[i]);
-					vShares[j][i] = split(j, rv, bits_v[i]);
+		void sendFrame(int fd, uint8_t op, uint8_t width, const std::vector<int32_t> &values) {
+			std::vector<char> &buf = frameBuffer; // Keeps its capacity between frames
+			const bool packed = (width & WIDTH_PACKED) != 0;
+			buf.resize(sizeof(frame_t) + (packed ? packedSize(values.size()) : values.size() * sizeof(uint32_t)));
+			frame_t hdr = {op, htonl(static_cast<uint32_t>(values.size())), width};
+			memcpy(buf.data(), &hdr, sizeof(hdr));
+			if (packed) {
+				packValues(values.data(), values.size(), reinterpret_cast<uint8_t *>(buf.data() + sizeof(hdr)));
+			} else {
+				uint32_t *payload = reinterpret_cast<uint32_t *>(buf.data() + sizeof(hdr));
+				for (size_t i = 0; i < values.size(); i++) {
+					uint32_t v = htonl(static_cast<uint32_t>(values[i]));
+					memcpy(payload + i, &v, sizeof(v));
 				}
 			}
+			if (sendAll(fd, buf.data(), buf.size()) != static_cast<ssize_t>(buf.size())) {
+				throw std::runtime_error("Send failed during batch");
+			}
+		}
 
-			int r0 = rand() % MOD;
-			for (int j = 0; j < 3; j++) {
-				task_t t = {OP_CMP, htonl(split(j, r0, 1)), 0, {0}, {0}};
-				for (int i = 0; i < l; i++) {
-					t.u_shares[i] = htonl(static_cast<int32_t>(uShares[j][i]));
-					t.v_shares[i] = htonl(static_cast<int32_t>(vShares[j][i]));
+		/*********************************************************************************
+		 * @brief Receive a batched frame from one agent.
+		 * @param int fd: agent socket
+		 * @param frame_t &hdr: receives the frame header (count in host byte order)
+		 * @param std::vector<int32_t> &values: receives the payload values
+		 *********************************************************************************/
+		void recvFrame(int fd, frame_t &hdr, std::vector<int32_t> &values) {
+			if (recvAll(fd, &hdr, sizeof(hdr)) != sizeof(hdr)) {
+				throw std::runtime_error("Agent disconnected during batch");
+			}
+			hdr.count = ntohl(hdr.count);
+			values.resize(hdr.count);
+			if (hdr.width & WIDTH_PACKED) {
+				std::vector<char> &buf = frameBuffer;
+				buf.resize(packedSize(hdr.count));
+				if (!buf.empty() && recvAll(fd, buf.data(), buf.size()) != static_cast<ssize_t>(buf.size())) {
+					throw std::runtime_error("Agent disconnected during batch");
 				}
-				send(cli[j], &t, sizeof(t), 0);
+				unpackValues(reinterpret_cast<const uint8_t *>(buf.data()), hdr.count, values.data());
+				return;
 			}
-
-			for (int32_t j = 0; j < l; j++) {
-				waitRenorm();
-				waitRenorm();
-				waitRenorm();
+			if (hdr.count && recvAll(fd, values.data(), hdr.count * sizeof(int32_t)) != static_cast<ssize_t>(hdr.count * sizeof(int32_t))) {
+				throw std::runtime_error("Agent disconnected during batch");
 			}
-			for (int32_t j = 1; j < l; j++) {
-				waitRenorm();
+			for (auto &v : values) {
+				v = static_cast<int32_t>(ntohl(static_cast<uint32_t>(v)));
 			}
-			for (int32_t j = 0; j < l; j++) {
-				waitRenorm();
+		}
+
+		/*********************************************************************************
+		 * @brief Append fresh shares of a secret to each agent's payload.
+		 * @param int32_t secret: value to share
+		 * @param std::vector<int32_t> payload[]: per-agent payloads
+		 *********************************************************************************/
+		void splitInto(int32_t secret, std::vector<int32_t> payload[]) {
+			int32_t r = rand() % MOD;
+			for (int j = 0; j < 3; j++) {
+				payload[j].push_back(split(j, r, secret));
 			}
+		}
 
-			int32_t resultShares[3];
-			for (int i = 0; i < 3; ++i) {
-				response_t r;
-				if (recvAll(cli[i], &r, sizeof(r)) != sizeof(r)) {
-					throw std::runtime_error("Agent disconnected during CMP");
-				}
-				resultShares[i] = ntohl(r.value);
+		/*********************************************************************************
+		 * @brief Append shares of the low width bits of a value, MSB first, to each payload.
+		 * @param int32_t value: value to decompose
+		 * @param int width: number of bits
+		 * @param std::vector<int32_t> payload[]: per-agent payloads
+		 *********************************************************************************/
+		void splitBitsInto(int32_t value, int width, std::vector<int32_t> payload[]) {
+			for (int i = 0; i < width; i++) {
+				splitInto((value >> (width - 1 - i)) & 1, payload);
 			}
-			return reconstruct(resultShares);
 		}
 
-	public:
 		/*********************************************************************************
-		 * @brief Get the singleton instance of NetIntContext.
-		 * @return NetIntContext&: reference to the singleton instance
+		 * @brief Modular inverse of a nonzero value by Fermat's little theorem.
 		 *********************************************************************************/
-		NetIntContext(const NetIntContext &) = delete;
-		NetIntContext &operator=(const NetIntContext &) = delete;
+		int32_t inverse(int32_t a) const {
+			int64_t result = 1, base = a % MOD;
+			for (int32_t e = MOD - 2; e > 0; e >>= 1) {
+				if (e & 1) result = result * base % MOD;
+				base = base * base % MOD;
+			}
+			return static_cast<int32_t>(result);
+		}
 
-		static NetIntContext &getInstance() {
-			if (!instance) {
-				instance = std::unique_ptr<NetIntContext>(new NetIntContext());
+		/*********************************************************************************
+		 * @brief Deal one zero-test mask of the given degree to each payload.
+		 * @param int degree: largest value the masked input can take
+		 * @param std::vector<int32_t> payload[]: per-agent payloads
+		 * @note Appends degree + 2 shares: a random nonzero m, its inverse powers m^-1 ... m^-degree,
+		 *       and a degree-2 sharing of zero that rerandomizes the opened product.
+		 *********************************************************************************/
+		void dealMask(int degree, std::vector<int32_t> payload[]) {
+			int32_t m = 1 + rand() % (MOD - 1);
+			int32_t mInv = inverse(m);
+			splitInto(m, payload);
+			int64_t power = 1;
+			for (int i = 1; i <= degree; i++) {
+				power = power * mInv % MOD;
+				splitInto(static_cast<int32_t>(power), payload);
+			}
+			int64_t a1 = rand() % MOD, a2 = rand() % MOD;
+			for (int j = 0; j < 3; j++) {
+				payload[j].push_back(static_cast<int32_t>((a1 * (j + 1) + a2 * (j + 1) * (j + 1)) % MOD));
 			}
-			return *instance;
 		}
 
 		/*********************************************************************************
-		 * @brief Set an IP whitelist for allowed agent connections.
-		 * @param const std::vector<std::string> &allowedIPs: list of allowed IP addresses
+		 * @brief Append count zero-test masks of the given degree, from the pool when available.
+		 * @param int degree: mask degree, the comparison width
+		 * @param size_t count: number of masks
+		 * @param std::vector<int32_t> payload[]: per-agent payloads
+		 * @note Masks missing from the pool are dealt on demand.
 		 *********************************************************************************/
-		void setIPWhitelist(const std::vector<std::string> &allowedIPs) {
-			whitelist = allowedIPs;
-			useWhitelist = true;
-			printMessage("IP whitelist enabled with " + std::to_string(allowedIPs.size()) + " addresses\n");
+		void appendMasks(int degree, size_t count, std::vector<int32_t> payload[]) {
+			MaskPool &pool = maskPools[degree];
+			const size_t stride = degree + 2;
+			size_t available = pool.shares[0].size() / stride - pool.next;
+			size_t taken = std::min(count, available);
+			for (int j = 0; j < 3; j++) {
+				auto first = pool.shares[j].begin() + pool.next * stride;
+				payload[j].insert(payload[j].end(), first, first + taken * stride);
+			}
+			pool.next += taken;
+			if (pool.next * stride == pool.shares[0].size()) {
+				for (int j = 0; j < 3; j++) {
+					pool.shares[j].clear();
+				}
+				pool.next = 0;
+			}
+			for (size_t i = taken; i < count; i++) {
+				dealMask(degree, payload);
+			}
 		}
 
 		/*********************************************************************************
-		 * @brief Clear the IP whitelist, allowing connections from all agents.
+		 * @brief Switch a comparison opcode to the preprocessed protocol when it is selected.
+		 * @param uint8_t op: base comparison opcode
+		 * @param int width: bits per operand
+		 * @param size_t masks: zero-test masks the preprocessed protocol consumes
+		 * @param std::vector<int32_t> payload[]: per-agent payloads, masks are appended
+		 * @return uint8_t: opcode to send
+		 * @note With the Dealer backend no masks travel, each agent takes them from its store.
 		 *********************************************************************************/
-		void clearIPWhitelist() {
-			whitelist.clear();
-			useWhitelist = false;
-			printMessage("IP whitelist disabled - allowing all connections\n");
+		uint8_t withBackend(uint8_t op, int width, size_t masks, std::vector<int32_t> payload[]) {
+			if (compareBackend == CompareBackend::Dealer) return op | OP_PRE | OP_STORE;
+			if (compareBackend != CompareBackend::Preprocessed) return op;
+			appendMasks(width, masks, payload);
+			return op | OP_PRE;
 		}
 
 		/*********************************************************************************
-		 * @brief Establish a socket connection to the specified port and wait for 3 agent connections.
-		 * @param const std::string &port: port number to bind to
+		 * @brief Lagrange coefficients of a degree-1 polynomial through two agents' shares.
+		 * @param int32_t x: point to evaluate at, 0 for the secret
+		 * @param int i: first agent (0-based)
+		 * @param int j: second agent (0-based)
+		 * @param int64_t &li: coefficient of agent i's share
+		 * @param int64_t &lj: coefficient of agent j's share
 		 *********************************************************************************/
-		void socket(const std::string &port) {
-			if (initialized) return;
+		void pairCoefficients(int32_t x, int i, int j, int64_t &li, int64_t &lj) const {
+			const int32_t xi = i + 1, xj = j + 1;
+			li = (static_cast<int64_t>(x - xj + MOD) * inverse((xi - xj + MOD) % MOD)) % MOD;
+			lj = (static_cast<int64_t>(x - xi + MOD) * inverse((xj - xi + MOD) % MOD)) % MOD;
+		}
 
-			ln = bindAndListen(port);
-			char buf[6];
-			int joined = 0;
+		/*********************************************************************************
+		 * @brief Read the oldest result an agent still owes and check it if required.
+		 * @param int i: agent index
+		 *********************************************************************************/
+		void drainLate(int i) {
+			LateShares owed = std::move(late[i].front());
+			late[i].pop_front();
+			std::vector<int32_t> got;
+			if (owed.batch) {
+				frame_t hdr;
+				recvFrame(cli[i], hdr, got);
+				if (hdr.op != (OP_RES | OP_BATCH)) throw std::runtime_error("Invalid late batch response");
+			} else {
+				response_t r;
+				if (recvAll(cli[i], &r, sizeof(r)) != sizeof(r)) throw std::runtime_error("Agent disconnected before sending a late share");
+				got.push_back(static_cast<int32_t>(ntohl(r.value)));
+			}
+			if (!owed.expected.empty() && got != owed.expected) {
+				throw std::runtime_error("Agent " + std::to_string(i + 1) + " sent a share inconsistent with the other two");
+			}
+		}
 
-			printMessage("Waiting for 3 agents to connect...\n");
-			if (useWhitelist) {
-				printMessage("IP whitelist active with " + std::to_string(whitelist.size()) + " allowed addresses\n");
+		/*********************************************************************************
+		 * @brief Read every result an agent still owes, so its next reply is current.
+		 *********************************************************************************/
+		void settleLate(int i) {
+			while (!late[i].empty()) {
+				drainLate(i);
 			}
+		}
 
-			while (joined < 3) {
-				int cfd = accept(ln, nullptr, nullptr);
-				if (cfd < 0) {
-					perror("accept");
-					continue;
+		/*********************************************************************************
+		 * @brief Wait until one of the agents that have not answered yet has a current reply.
+		 * @param const bool have[3]: agents that already answered
+		 * @return int: index of an agent whose next message is the reply to the current task
+		 * @note Late shares from earlier tasks are consumed as they come in.
+		 *********************************************************************************/
+		int nextReadyAgent(const bool have[3]) {
+			if (replayBase) {
+				// Every reply is already in the transcript
+				for (int i = 0; i < 3; i++) {
+					if (!have[i]) {
+						settleLate(i);
+						return i;
+					}
 				}
-
-				std::string clientIP = getClientIP(cfd);
-				if (!isWhitelisted(clientIP)) {
-					printMessage("Connection from " + clientIP + " rejected (not in whitelist)\n");
-					close(cfd);
-					continue;
+			}
+			for (;;) {
+				struct pollfd fds[3];
+				int agent[3], n = 0;
+				for (int i = 0; i < 3; i++) {
+					if (!have[i]) {
+						fds[n] = {cli[i], POLLIN, 0};
+						agent[n++] = i;
+					}
 				}
+				if (poll(fds, n, -1) < 0) {
+					if (errno == EINTR) continue;
+					throw std::runtime_error("poll failed while waiting for agents");
+				}
+				for (int k = 0; k < n; k++) {
+					if (!fds[k].revents) continue;
+					if (late[agent[k]].empty()) return agent[k];
+					drainLate(agent[k]);
+					break;
+				}
+			}
+		}
 
-				memset(buf, 0, sizeof(buf));
-				ssize_t r = recv(cfd, buf, sizeof(buf) - 1, 0);
-				if (r == 5 && memcmp(buf, "JOIN\n", 5) == 0) {
-					cli[joined++] = cfd;
-					printMessage("Agent " + std::to_string(joined) + " connected from " + clientIP + "\n");
+		/*********************************************************************************
+		 * @brief Collect one reply per agent, or only the first two final results if allowed.
+		 * @param frame_t hdr[3]: headers, valid where have is set
+		 * @param std::vector<int32_t> shares[3]: payloads, valid where have is set
+		 * @param bool have[3]: set for each agent that answered
+		 * @return int: an agent that answered, whose header describes the round
+		 * @note Renormalization and opening rounds always need all three shares, since their
+		 *       values have degree 2. Only OP_RES frames, which are degree 1, can finish early.
+		 *********************************************************************************/
+		int collectFrames(frame_t hdr[3], std::vector<int32_t> shares[3], bool have[3]) {
+			int first = -1;
+			for (int i = 0; i < 3; i++) {
+				have[i] = false;
+			}
+			for (int got = 0; got < 3; got++) {
+				int i = got;
+				if (stragglerPolicy == StragglerPolicy::Wait) {
+					settleLate(i);
 				} else {
-					printMessage("Invalid join message from " + clientIP + "\n");
-					close(cfd);
+					i = nextReadyAgent(have);
 				}
+				recvFrame(cli[i], hdr[i], shares[i]);
+				have[i] = true;
+				if (first < 0) {
+					first = i;
+				} else if (hdr[i].op != hdr[first].op || hdr[i].count != hdr[first].count) {
+					throw std::runtime_error("Mismatched batch frames from agents");
+				}
+				if (got == 1 && stragglerPolicy != StragglerPolicy::Wait && hdr[first].op == (OP_RES | OP_BATCH)) break;
 			}
-			close(ln);
-			ln = -1;
-			initialized = true;
-			printMessage("All agents connected\n");
+			return first;
 		}
 
 		/*********************************************************************************
-		 * @brief Disconnect from all agents and clean up resources.
+		 * @brief WIDTH_PACKED if every payload value fits in PACK_BITS, 0 otherwise.
 		 *********************************************************************************/
-		void disconnect() {
+		uint8_t packedWidth(const std::vector<int32_t> payload[]) const {
+			if (!packFrames) return 0;
+			// Shares always fit; public values such as constants or matrix sizes may not
 			for (int i = 0; i < 3; i++) {
-				if (cli[i] != -1) {
-					close(cli[i]);
-					cli[i] = -1;
+				for (int32_t v : payload[i]) {
+					if (v < 0 || v >= (1 << PACK_BITS)) return 0;
 				}
 			}
-			initialized = false;
-			printMessage("Disconnected from all agents\n");
+			return WIDTH_PACKED;
 		}
 
 		/*********************************************************************************
-		 * @brief Run an addition operation with the MPC protocol.
-		 * @param int a: first operand
-		 * @param int b: second operand
-		 * @return int32_t: result of the addition
+		 * @brief Run one batched task on all agents and reconstruct its results.
+		 * @param uint8_t op: base opcode, OP_BATCH is added
+		 * @param uint8_t width: bit width of comparison operands
+		 * @param std::vector<int32_t> payload[]: per-agent payloads
+		 * @return std::vector<int32_t>: reconstructed results, one per output
+		 * @note Every renormalization or opening round the agents request is served with a
+		 *       single frame per agent, however many values it carries.
 		 *********************************************************************************/
-		int32_t runAdd(int32_t a, int32_t b) {
+		std::vector<int32_t> runBatch(uint8_t op, uint8_t width, std::vector<int32_t> payload[]) {
 			if (!initialized) throw std::logic_error("MPC context not initialized, need to add the following line before using a NetInt operation:\nestablishPort(\"1234567\");");
-
-			int32_t resultShares[3];
-			int r1 = rand() % MOD;
-			int r2 = rand() % MOD;
-			uint8_t op = OP_ADD;
+			width |= packedWidth(payload);
+			if (simulated) return simulateBatch(op, width, payload);
 
 			for (int i = 0; i < 3; i++) {
-				int32_t aShare = split(i, r1, a);
-				int32_t bShare = split(i, r2, b);
-				task_t t = {op, htonl(static_cast<uint32_t>(aShare)), htonl(static_cast<uint32_t>(bShare)), {0}, {0}};
-				send(cli[i], &t, sizeof(t), 0);
+				sendFrame(cli[i], op | OP_BATCH, width, payload[i]);
 			}
 
-			for (int i = 0; i < 3; i++) {
-				response_t r;
-				if (recvAll(cli[i], &r, sizeof(r)) != sizeof(r)) {
-					throw std::runtime_error("Agent disconnected during ADD");
+			std::vector<int32_t> shares[3];
+			bool have[3];
+			for (;;) {
+				frame_t hdr[3];
+				int first = collectFrames(hdr, shares, have);
+				if (hdr[first].op == (OP_RES | OP_BATCH)) break;
+				if (hdr[first].op == (OP_OPN | OP_BATCH)) {
+					// Masked values are public once reconstructed, every agent gets the same list
+					for (uint32_t k = 0; k < hdr[0].count; k++) {
+						int32_t column[3] = {shares[0][k], shares[1][k], shares[2][k]};
+						shares[0][k] = reconstruct(column);
+					}
+					for (int i = 0; i < 3; i++) {
+						sendFrame(cli[i], OP_OPN | OP_BATCH, width, shares[0]);
+					}
+					continue;
 				}
-				if (r.op != OP_RES) {
-					throw std::runtime_error("Invalid ADD response");
+				if (hdr[first].op != (OP_REN | OP_BATCH)) {
+					throw std::runtime_error("Invalid batch response");
+				}
+				for (uint32_t k = 0; k < hdr[first].count; k++) {
+					int32_t column[3] = {shares[0][k], shares[1][k], shares[2][k]};
+					renormalize(column);
+					for (int i = 0; i < 3; i++) {
+						shares[i][k] = column[i];
+					}
+				}
+				for (int i = 0; i < 3; i++) {
+					sendFrame(cli[i], OP_REN | OP_BATCH, width, shares[i]);
 				}
-				resultShares[i] = ntohl(r.value);
 			}
-			return reconstruct(resultShares);
-		}
 
-		/*********************************************************************************
-		 * @brief Control whether non-error messages are printed to console.
-		 * @param bool show: true to show messages, false to hide them
-		 *********************************************************************************/
-		void hideMessages(bool hide = true) {
-			showMessages = !hide;
-			if (!hide) {
-				printMessage("Non-error messages will be printed\n");
-			}
+			return reconstructResults(shares, have, true);
 		}
 
 		/*********************************************************************************
-		 * @brief Run a multiplication operation with the MPC protocol.
-		 * @param int a: first operand
-		 * @param int b: second operand
-		 * @return int32_t: result of the multiplication
+		 * @brief Reconstruct degree-1 results from the agents that answered.
+		 * @param std::vector<int32_t> shares[3]: per-agent result shares
+		 * @param const bool have[3]: agents that answered, at least two
+		 * @param bool batch: whether the missing agent will reply with a batched frame
+		 * @return std::vector<int32_t>: reconstructed results
+		 * @note With two shares the pair's own Lagrange coefficients give the secret, and the
+		 *       missing agent's reply is recorded so it can be checked or skipped later.
 		 *********************************************************************************/
-		int32_t runMul(int32_t a, int32_t b) {
-			if (!initialized) throw std::logic_error("MPC context not initialized, need to add the following line before using a NetInt operation:\nestablishPort(\"1234567\");");
-
-			int32_t resultShares[3];
-			int r1 = rand() % MOD;
-			int r2 = rand() % MOD;
-			uint8_t op = OP_MUL;
-
+		std::vector<int32_t> reconstructResults(std::vector<int32_t> shares[3], const bool have[3], bool batch) {
+			int missing = -1;
 			for (int i = 0; i < 3; i++) {
-				int32_t aShare = split(i, r1, a);
-				int32_t bShare = split(i, r2, b);
-				task_t t = {op, htonl(static_cast<uint32_t>(aShare)), htonl(static_cast<uint32_t>(bShare)), {0}, {0}};
-				send(cli[i], &t, sizeof(t), 0);
+				if (!have[i]) missing = i;
 			}
-
-			for (int i = 0; i < 3; i++) {
-				response_t r;
-				if (recvAll(cli[i], &r, sizeof(r)) != sizeof(r)) {
-					throw std::runtime_error("Agent disconnected during MUL");
+			size_t count = shares[missing == 0 ? 1 : 0].size();
+			std::vector<int32_t> results(count);
+			if (missing < 0) {
+				for (size_t k = 0; k < count; k++) {
+					int32_t column[3] = {shares[0][k], shares[1][k], shares[2][k]};
+					results[k] = reconstruct(column);
 				}
-				if (r.op != OP_RES) {
-					throw std::runtime_error("Invalid MUL response");
+				return results;
+			}
+
+			int i = (missing == 0) ? 1 : 0, j = (missing == 2) ? 1 : 2;
+			int64_t li, lj, mi, mj;
+			pairCoefficients(0, i, j, li, lj);
+			pairCoefficients(missing + 1, i, j, mi, mj);
+			LateShares owed = {batch, {}};
+			if (stragglerPolicy == StragglerPolicy::Check) owed.expected.resize(count);
+			for (size_t k = 0; k < count; k++) {
+				results[k] = static_cast<int32_t>((li * shares[i][k] + lj * shares[j][k]) % MOD);
+				if (stragglerPolicy == StragglerPolicy::Check) {
+					owed.expected[k] = static_cast<int32_t>((mi * shares[i][k] + mj * shares[j][k]) % MOD);
 				}
-				resultShares[i] = ntohl(r.value);
 			}
-			renormalize(resultShares);
-			return reconstruct(resultShares);
+			late[missing].push_back(std::move(owed));
+			return results;
 		}
 
 		/*********************************************************************************
-		 * @brief Run a comparison operation with the MPC protocol, specifically the add functions.
-		 * @param int32_t a: first operand
-		 * @param int32_t b: second operand
-		 * @return int32_t: result of the comparison (0 or 1)
+		 * @brief Hand a single operation to the auto-batcher and wait for its result.
+		 * @param int32_t &result: receives the result
+		 * @return bool: false if auto-batching is off, and the caller runs the operation itself
+		 * @note Blocks while maxPending operations are already queued, so callers slow down
+		 *       to the pace the agents keep up with.
 		 *********************************************************************************/
-		int32_t runSub(int32_t a, int32_t b) {
-			// a - b = a + (MOD - b) mod MOD
-			return runAdd(a, (MOD - b) % MOD);
+		bool enqueue(Queued kind, int32_t a, int32_t b, int width, int32_t &result) {
+			std::future<int32_t> future;
+			{
+				std::unique_lock<std::mutex> lock(queueLock);
+				queueSpace.wait(lock, [&] { return queue.size() < maxPending || !batching; });
+				if (!batching) return false;
+				queue.push_back({kind, width, a, b, std::promise<int32_t>(), std::chrono::steady_clock::now(), simulated ? costSite() : std::string()});
+				future = queue.back().result.get_future();
+				if (queue.size() == 1 || queue.size() >= batchSize) queueReady.notify_one();
+			}
+			result = future.get();
+			return true;
 		}
 
 		/*********************************************************************************
-		 * @brief Run less than comparison with the MPC protocol, specifically.
-		 * @param int32_t a: first operand
-		 * @param int32_t b: second operand
-		 * @return int32_t: result of the comparison (0 or 1)
+		 * @brief Auto-batcher thread: flush the queue once it holds batchSize operations or
+		 *        its oldest operation has waited batchWindow, until told to stop.
+		 * @note Stopping flushes whatever is still queued.
 		 *********************************************************************************/
-		int32_t runLT(int32_t a, int32_t b) {
-			int32_t cmp = runCMP(a, b);
-			return (cmp > MOD / 2) ? 1 : 0;
+		void batchLoop() {
+			std::unique_lock<std::mutex> lock(queueLock);
+			for (;;) {
+				queueReady.wait(lock, [&] { return stopBatching || !queue.empty(); });
+				if (queue.empty()) return;
+				queueReady.wait_until(lock, queue.front().queued + batchWindow, [&] { return stopBatching || queue.size() >= batchSize; });
+				size_t take = std::min(queue.size(), batchSize);
+				std::vector<QueuedOp> ops(std::make_move_iterator(queue.begin()), std::make_move_iterator(queue.begin() + take));
+				queue.erase(queue.begin(), queue.begin() + take);
+				queueSpace.notify_all();
+				lock.unlock();
+				runQueued(ops);
+				lock.lock();
+			}
 		}
 
 		/*********************************************************************************
-		 * @brief Run less than or equal to comparison with the MPC protocol.
-		 * @param int32_t a: first operand
-		 * @param int32_t b: second operand
-		 * @return int32_t: result of the comparison (0 or 1)
+		 * @brief Run queued operations as one batched task per kind, width and cost site.
+		 * @note A failed task fails the operations it carried; their callers see the exception.
+		 *       Each task runs under the CostScope its operations were queued from.
 		 *********************************************************************************/
-		int32_t runLE(int32_t a, int32_t b) {
-			int32_t cmp = runCMP(a, b);
-			return (cmp == 0 || cmp > MOD / 2) ? 1 : 0;
+		void runQueued(std::vector<QueuedOp> &ops) {
+			std::map<std::tuple<std::string, Queued, int>, std::vector<QueuedOp *>> groups;
+			for (QueuedOp &op : ops) {
+				groups[{op.site, op.kind, op.width}].push_back(&op);
+			}
+			for (auto &group : groups) {
+				std::vector<int32_t> a, b, results;
+				for (const QueuedOp *op : group.second) {
+					a.push_back(op->a);
+					b.push_back(op->b);
+				}
+				std::vector<std::string> &sites = costSites();
+				sites.assign(1, std::get<0>(group.first));
+				try {
+					int width = std::get<2>(group.first);
+					switch (std::get<1>(group.first)) {
+					case Queued::Mul: results = runBatchMul(a, b); break;
+					case Queued::LT: results = runBatchLT(a, b, width); break;
+					case Queued::EQ: results = runBatchEQ(a, b, width); break;
+					case Queued::LTPublic: results = runBatchLTPublic(a, b, width); break;
+					case Queued::EQPublic: results = runBatchEQPublic(a, b, width); break;
+					}
+					for (size_t i = 0; i < group.second.size(); i++) {
+						group.second[i]->result.set_value(results[i]);
+					}
+				} catch (...) {
+					for (QueuedOp *op : group.second) {
+						op->result.set_exception(std::current_exception());
+					}
+				}
+				sites.clear();
+			}
 		}
 
 		/*********************************************************************************
-		 * @brief Run greater than comparison with the MPC protocol.
-		 * @param int32_t a: first operand
-		 * @param int32_t b: second operand
-		 * @return int32_t: result of the comparison (0 or 1)
+		 * @brief CostScope labels open on the calling thread, outermost first.
+		 * @note Per thread, so scopes on different threads never pop each other's labels and
+		 *       the auto-batcher can run a task under the scope its operations came from.
 		 *********************************************************************************/
-		int32_t runGT(int32_t a, int32_t b) {
-			return runLT(b, a);
+		static std::vector<std::string> &costSites() {
+			thread_local std::vector<std::string> sites;
+			return sites;
+		}
+
+		static std::string costSite() {
+			std::string site;
+			for (const auto &label : costSites()) {
+				site += (site.empty() ? "" : "/") + label;
+			}
+			return site;
 		}
 
 		/*********************************************************************************
-		 * @brief Run greater than or equal to comparison with the MPC protocol.
-		 * @param int32_t a: first operand
-		 * @param int32_t b: second operand
-		 * @return int32_t: result of the comparison (0 or 1)
+		 * @brief Counters of an operation under the current CostScope.
+		 * @note Callers hold wire, which serializes every update to costs.
 		 *********************************************************************************/
-		int32_t runGE(int32_t a, int32_t b) {
-			return runLE(b, a);
+		CostCounters &costOf(const std::string &op) {
+			return costs[{costSite(), op}];
 		}
 
 		/*********************************************************************************
-		 * @brief Run equality comparison with the MPC protocol.
-		 * @param int32_t a: first operand
-		 * @param int32_t b: second operand
-		 * @return int32_t: result of the comparison (0 or 1)
+		 * @brief Count one renormalization or opening layer of count values.
+		 * @note Over the mesh an agent sends its values to both peers and receives theirs, as
+		 *       bare arrays. Otherwise it sends one frame to the primary and receives one back.
+		 *********************************************************************************/
+		void chargeLayer(CostCounters &cost, uint32_t count, bool packed) {
+			if (count == 0) return; // The agents skip empty layers
+			cost.rounds++;
+			if (meshActive) {
+				cost.messages += 4;
+				cost.bytes += 4 * wireBytes(count, packed);
+			} else {
+				cost.messages += 2;
+				cost.bytes += 2 * (sizeof(frame_t) + wireBytes(count, packed));
+			}
+		}
+
+		static uint64_t wireBytes(size_t count, bool packed) {
+			return packed ? packedSize(count) : count * sizeof(int32_t);
+		}
+
+		/*********************************************************************************
+		 * @brief Layers of the bitwise less than chain after its per-bit products, as prefixLT
+		 *        in agent.c runs them.
 		 *********************************************************************************/
-		int32_t runEQ(int32_t a, int32_t b) {
-			int32_t cmp = runCMP(a, b);
-			return (cmp == 0) ? 1 : 0;
+		void chargePrefixLT(CostCounters &cost, uint32_t n, uint32_t w, bool packed) {
+			for (uint32_t d = 1; d + 1 < w; d <<= 1) {
+				chargeLayer(cost, n * (w - 1 - d), packed);
+			}
+			chargeLayer(cost, n * (w - 1), packed);
 		}
 
 		/*********************************************************************************
-		 * @brief Run not equal to comparison with the MPC protocol.
-		 * @param int32_t a: first operand
-		 * @param int32_t b: second operand
-		 * @return int32_t: result of the comparison (0 or 1)
+		 * @brief Layers of the log-depth product tree over w terms, as productTree in agent.c.
+		 *********************************************************************************/
+		void chargeProductTree(CostCounters &cost, uint32_t n, uint32_t w, bool packed) {
+			for (uint32_t len = w; len > 1; len = (len + 1) / 2) {
+				chargeLayer(cost, n * (len / 2), packed);
+			}
+		}
+
+		/*********************************************************************************
+		 * @brief Run a batched task without agents: open the payload, compute the results in
+		 *        the clear, and count the traffic the agents' protocol would produce.
+		 * @param uint8_t op: base opcode with OP_PRE and OP_STORE as runBatch receives it
+		 * @param uint8_t width: bit width of comparison operands, with WIDTH_SUM
+		 * @param std::vector<int32_t> payload[]: per-agent payloads
+		 * @return std::vector<int32_t>: results, as runBatch would reconstruct them
+		 *********************************************************************************/
+		std::vector<int32_t> simulateBatch(uint8_t op, uint8_t width, std::vector<int32_t> payload[]) {
+			const uint8_t base = op & ~(OP_PRE | OP_STORE);
+			const bool pre = (op & OP_PRE) != 0;
+			const uint32_t w = (width & ~(WIDTH_SUM | WIDTH_PACKED)) ? (width & ~(WIDTH_SUM | WIDTH_PACKED)) : 1;
+			const uint32_t mask = (pre && !(op & OP_STORE)) ? w + 2 : 0; // Mask shares sent per zero test
+			const bool packed = (width & WIDTH_PACKED) != 0;
+			auto open = [&](size_t k) {
+				int32_t column[3] = {payload[0][k], payload[1][k], payload[2][k]};
+				return reconstruct(column);
+			};
+			auto openBits = [&](size_t first) {
+				int32_t v = 0;
+				for (uint32_t j = 0; j < w; j++) {
+					v = (v << 1) | open(first + j);
+				}
+				return v;
+			};
+
+			static const char *const names[] = {"", "ADD", "MUL", "CMP", "EQ", "LT", "DOT", "LT public", "EQ public"};
+			std::string name = names[base];
+			if (base == OP_DOT && (op & OP_STORE)) name += " kept";
+			if (base != OP_MUL && base != OP_DOT) {
+				name += std::string(compareBackend == CompareBackend::Bitwise ? "" : " preprocessed") + " w" + std::to_string(w);
+			}
+			if (width & WIDTH_SUM) name += " count";
+			CostCounters &cost = costOf(name);
+
+			std::vector<int32_t> out;
+			const size_t size = payload[0].size();
+			if (base == OP_MUL) {
+				size_t n = size / 2;
+				for (size_t k = 0; k < n; k++) {
+					out.push_back(static_cast<int32_t>(static_cast<int64_t>(open(k)) * open(n + k) % MOD));
+				}
+				chargeLayer(cost, static_cast<uint32_t>(n), packed);
+			} else if (base == OP_DOT) {
+				uint32_t n = payload[0][0], k = payload[0][1], m = payload[0][2];
+				// With OP_STORE the right operand is the matrix the agents keep
+				auto right = [&](size_t p) { return (op & OP_STORE) ? keptValues[p] : open(3 + static_cast<size_t>(n) * k + p); };
+				for (uint32_t i = 0; i < n; i++) {
+					for (uint32_t j = 0; j < m; j++) {
+						int64_t sum = 0;
+						for (uint32_t p = 0; p < k; p++) {
+							sum = (sum + static_cast<int64_t>(open(3 + i * k + p)) * right(static_cast<size_t>(p) * m + j)) % MOD;
+						}
+						out.push_back(static_cast<int32_t>(sum));
+					}
+				}
+				chargeLayer(cost, n * m, packed);
+			} else if (base == OP_LT || base == OP_EQL) {
+				uint32_t n = static_cast<uint32_t>(size / (2 * w + (base == OP_LT ? w * mask : mask)));
+				for (uint32_t i = 0; i < n; i++) {
+					int32_t u = openBits(static_cast<size_t>(i) * w), v = openBits(static_cast<size_t>(n + i) * w);
+					out.push_back(base == OP_LT ? u < v : u == v);
+				}
+				if (pre) {
+					chargeLayer(cost, n * w, packed); // Per-bit XORs
+					chargeLayer(cost, base == OP_LT ? n * w : n, packed); // Zero-test opening
+					if (base == OP_LT) chargeLayer(cost, n * w, packed); // First difference times v
+				} else {
+					chargeLayer(cost, n * w, packed); // Per-bit products
+					if (base == OP_LT) chargePrefixLT(cost, n, w, packed);
+					else chargeProductTree(cost, n, w, packed);
+				}
+			} else if (base == OP_LTC || base == OP_EQC) {
+				uint32_t n = static_cast<uint32_t>(size / (w + 1 + (base == OP_LTC ? w * mask : mask)));
+				for (uint32_t i = 0; i < n; i++) {
+					int32_t u = openBits(static_cast<size_t>(i) * w), c = payload[0][static_cast<size_t>(n) * w + i] & ((1 << w) - 1);
+					out.push_back(base == OP_LTC ? u < c : u == c);
+				}
+				if (pre) chargeLayer(cost, base == OP_LTC ? n * w : n, packed);
+				else if (base == OP_LTC) chargePrefixLT(cost, n, w, packed);
+				else chargeProductTree(cost, n, w, packed);
+			} else {
+				throw std::logic_error("Cannot simulate batch op " + std::to_string(op));
+			}
+
+			if (width & WIDTH_SUM) {
+				int64_t total = 0;
+				for (int32_t v : out) {
+					total += v;
+				}
+				out.assign(1, static_cast<int32_t>(total % MOD));
+			}
+			cost.tasks++;
+			cost.rounds++;
+			cost.messages += 2;
+			cost.bytes += 2 * sizeof(frame_t) + wireBytes(size, packed) + wireBytes(out.size(), packed);
+			return out;
+		}
+
+		/*********************************************************************************
+		 * @brief Count a single-value task and its one-share reply.
+		 *********************************************************************************/
+		void chargeScalar(const std::string &name) {
+			CostCounters &cost = costOf(name);
+			cost.tasks++;
+			cost.rounds++;
+			cost.messages += 2;
+			cost.bytes += sizeof(task_t) + sizeof(response_t);
+		}
+
+	public:
+		/*********************************************************************************
+		 * @brief Get the singleton instance of NetIntContext.
+		 * @return NetIntContext&: reference to the singleton instance
+		 *********************************************************************************/
+		NetIntContext(const NetIntContext &) = delete;
+		NetIntContext &operator=(const NetIntContext &) = delete;
+
+		static NetIntContext &getInstance() {
+			if (!instance) {
+				instance = std::unique_ptr<NetIntContext>(new NetIntContext());
+			}
+			return *instance;
+		}
+
+		~NetIntContext() {
+			stopAutoBatch();
+		}
+
+		/*********************************************************************************
+		 * @brief Queue single multiplications and comparisons from all threads and run them
+		 *        as batched tasks.
+		 * @param size_t maxBatch: operations that trigger a flush
+		 * @param uint32_t windowMicros: longest an operation waits for others to join it
+		 * @param size_t maxPendingOps: queued operations beyond which callers block, 0 for
+		 *        8 * maxBatch
+		 * @note A flush sends one task per kind of operation and comparison width. A single
+		 *       thread gains nothing, since each of its operations waits for the window.
+		 *********************************************************************************/
+		void startAutoBatch(size_t maxBatch, uint32_t windowMicros, size_t maxPendingOps) {
+			stopAutoBatch();
+			std::lock_guard<std::mutex> lock(queueLock);
+			batchSize = std::max<size_t>(maxBatch, 1);
+			batchWindow = std::chrono::microseconds(windowMicros);
+			maxPending = maxPendingOps ? std::max(maxPendingOps, batchSize) : 8 * batchSize;
+			stopBatching = false;
+			batching = true;
+			batcher = std::thread(&NetIntContext::batchLoop, this);
+		}
+
+		/*********************************************************************************
+		 * @brief Flush the queue, stop the auto-batcher, and run operations directly again.
+		 *********************************************************************************/
+		void stopAutoBatch() {
+			{
+				std::lock_guard<std::mutex> lock(queueLock);
+				if (!batcher.joinable()) return;
+				batching = false;
+				stopBatching = true;
+			}
+			queueReady.notify_one();
+			queueSpace.notify_all();
+			batcher.join();
+		}
+
+		/*********************************************************************************
+		 * @brief Set an IP whitelist for allowed agent connections.
+		 * @param const std::vector<std::string> &allowedIPs: list of allowed IP addresses
+		 *********************************************************************************/
+		void setIPWhitelist(const std::vector<std::string> &allowedIPs) {
+			whitelist = allowedIPs;
+			useWhitelist = true;
+			printMessage("IP whitelist enabled with " + std::to_string(allowedIPs.size()) + " addresses\n");
+		}
+
+		/*********************************************************************************
+		 * @brief Clear the IP whitelist, allowing connections from all agents.
+		 *********************************************************************************/
+		void clearIPWhitelist() {
+			whitelist.clear();
+			useWhitelist = false;
+			printMessage("IP whitelist disabled - allowing all connections\n");
+		}
+
+		/*********************************************************************************
+		 * @brief Select the protocol used for secret comparisons.
+		 * @param CompareBackend backend: Bitwise or Preprocessed
+		 *********************************************************************************/
+		void setComparisonBackend(CompareBackend backend) {
+			compareBackend = backend;
+		}
+
+		CompareBackend getComparisonBackend() const {
+			return compareBackend;
+		}
+
+		/*********************************************************************************
+		 * @brief Select how results are collected when an agent answers late.
+		 * @param StragglerPolicy policy: Wait, Check, or Discard
+		 *********************************************************************************/
+		void setStragglerPolicy(StragglerPolicy policy) {
+			stragglerPolicy = policy;
+		}
+
+		/*********************************************************************************
+		 * @brief Let the agents renormalize and open shares over direct connections.
+		 * @param bool enable: set up the mesh when the agents connect, on by default
+		 * @note Takes effect at the next establishPort. Agents that cannot reach each other
+		 *       keep relaying those rounds through the primary.
+		 *********************************************************************************/
+		void setAgentMesh(bool enable) {
+			meshEnabled = enable;
+		}
+
+		bool agentMeshActive() const {
+			return meshActive;
+		}
+
+		/*********************************************************************************
+		 * @brief Pack the values of batched frames at 14 bits instead of 32.
+		 * @param bool enable: on by default
+		 * @note A task whose payload holds a public value of 2^14 or more, such as a large
+		 *       constant, is sent unpacked.
+		 *********************************************************************************/
+		void setPackedFrames(bool enable) {
+			packFrames = enable;
+		}
+
+		/*********************************************************************************
+		 * @brief Record every frame exchanged with the agents from now on.
+		 * @param const std::string &path: transcript file to create
+		 * @note Call before establishPort to include the mesh setup. The file is closed by
+		 *       disconnectAgents.
+		 *********************************************************************************/
+		void recordTranscript(const std::string &path) {
+			if (transcript) fclose(transcript);
+			transcript = fopen(path.c_str(), "wb");
+			if (!transcript) throw std::runtime_error("Cannot create transcript " + path + ": " + strerror(errno));
+			setvbuf(transcript, nullptr, _IOFBF, 1 << 20);
+			transcriptStart = nowNs();
+			TranscriptHeader hdr = {};
+			memcpy(hdr.magic, TRANSCRIPT_MAGIC, sizeof(hdr.magic));
+			hdr.role = TRANSCRIPT_PRIMARY;
+			hdr.startNs = transcriptStart;
+			fwrite(&hdr, sizeof(hdr), 1, transcript);
+		}
+
+		/*********************************************************************************
+		 * @brief Use a recorded transcript in place of the agents.
+		 * @param const std::string &path: transcript recorded by the primary
+		 * @note Replaces establishPort. The program must issue the same operations as the
+		 *       recorded run. Agent replies are read from the memory-mapped file and what the
+		 *       primary sends is dropped, so its own share handling runs at full speed.
+		 *********************************************************************************/
+		void replayTranscript(const std::string &path) {
+			if (initialized) return;
+			int tfd = open(path.c_str(), O_RDONLY);
+			struct stat st;
+			if (tfd < 0 || fstat(tfd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(TranscriptHeader)) {
+				if (tfd >= 0) close(tfd);
+				throw std::runtime_error("Cannot read transcript " + path);
+			}
+			void *p = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, tfd, 0);
+			close(tfd);
+			if (p == MAP_FAILED) throw std::runtime_error("Cannot map transcript " + path);
+			TranscriptHeader hdr;
+			memcpy(&hdr, p, sizeof(hdr));
+			if (memcmp(hdr.magic, TRANSCRIPT_MAGIC, sizeof(hdr.magic)) != 0 || hdr.role != TRANSCRIPT_PRIMARY) {
+				munmap(p, st.st_size);
+				throw std::runtime_error(path + " is not a transcript recorded by the primary");
+			}
+			replayBase = static_cast<const char *>(p);
+			replaySize = st.st_size;
+			for (int i = 0; i < 3; i++) {
+				cli[i] = -2 - i; // Stands for agent i + 1's connection in the transcript
+				replayPos[i + 1] = sizeof(hdr);
+				replayUsed[i + 1] = 0;
+			}
+			initialized = true;
+			printMessage("Replaying " + path + "\n");
+
+			// Set up the mesh if the recorded run did
+			uint8_t op = 0;
+			size_t pos = replayPos[1], used = replayUsed[1];
+			bool mesh = replayRead(1, &op, 1) == 1 && op == (OP_MESH | OP_BATCH);
+			replayPos[1] = pos;
+			replayUsed[1] = used;
+			if (mesh) connectMesh();
+		}
+
+		/*********************************************************************************
+		 * @brief Deal zero-test masks ahead of time for the preprocessed comparison backend.
+		 * @param size_t count: number of comparisons to prepare for
+		 * @param int width: bits per operand, defaults to l
+		 * @note A less than comparison consumes width masks and an equality test consumes one,
+		 *       so count less than comparisons' worth is enough for any mix of count tests.
+		 *       Comparisons that find the pool empty deal their masks on demand.
+		 *********************************************************************************/
+		void preprocessComparisons(size_t count, int width = l) {
+			std::lock_guard<std::mutex> guard(wire);
+			if (width < 1 || width > l) throw std::invalid_argument("Comparison width must be between 1 and " + std::to_string(l));
+			MaskPool &pool = maskPools[width];
+			for (size_t i = 0; i < count * width; i++) {
+				dealMask(width, pool.shares);
+			}
+		}
+
+		/*********************************************************************************
+		 * @brief Number of preprocessed zero-test masks left for a width.
+		 *********************************************************************************/
+		size_t preprocessedMasks(int width = l) const {
+			if (width < 1 || width > l) return 0;
+			const MaskPool &pool = maskPools[width];
+			return pool.shares[0].size() / (width + 2) - pool.next;
+		}
+
+		/*********************************************************************************
+		 * @brief Establish a socket connection to the specified port and wait for 3 agent connections.
+		 * @param const std::string &port: port number to bind to
+		 *********************************************************************************/
+		void socket(const std::string &port) {
+			if (initialized) return;
+
+			ln = bindAndListen(port);
+			int joined = 0;
+			// Agents that sent a plain JOIN wait here for the slots nobody claimed by index
+			struct Unindexed {
+				int fd, meshPort;
+				std::string ip;
+			};
+			std::vector<Unindexed> unindexed;
+
+			printMessage("Waiting for 3 agents to connect...\n");
+			if (useWhitelist) {
+				printMessage("IP whitelist active with " + std::to_string(whitelist.size()) + " allowed addresses\n");
+			}
+
+			while (joined + static_cast<int>(unindexed.size()) < 3) {
+				int cfd = accept(ln, nullptr, nullptr);
+				if (cfd < 0) {
+					perror("accept");
+					continue;
+				}
+
+				std::string clientIP = getClientIP(cfd);
+				if (!isWhitelisted(clientIP)) {
+					printMessage("Connection from " + clientIP + " rejected (not in whitelist)\n");
+					close(cfd);
+					continue;
+				}
+
+				int meshPort = 0;
+				int slot = readJoin(cfd, meshPort);
+				if (slot < 0) {
+					printMessage("Invalid join message from " + clientIP + "\n");
+					close(cfd);
+					continue;
+				}
+				if (slot == 0) {
+					unindexed.push_back({cfd, meshPort, clientIP});
+					printMessage("Agent connected from " + clientIP + ", waiting for a free slot\n");
+					continue;
+				}
+				if (cli[--slot] != -1) {
+					printMessage("Agent slot " + std::to_string(slot + 1) + " already taken, rejecting " + clientIP + "\n");
+					close(cfd);
+					continue;
+				}
+				cli[slot] = cfd;
+				meshPorts[slot] = meshPort;
+				joined++;
+				printMessage("Agent " + std::to_string(slot + 1) + " connected from " + clientIP + "\n");
+			}
+			int slot = 0;
+			for (const Unindexed &agent : unindexed) {
+				while (cli[slot] != -1) slot++;
+				cli[slot] = agent.fd;
+				meshPorts[slot] = agent.meshPort;
+				printMessage("Agent " + std::to_string(slot + 1) + " connected from " + agent.ip + "\n");
+			}
+			close(ln);
+			ln = -1;
+			initialized = true;
+			printMessage("All agents connected\n");
+			if (meshEnabled) connectMesh();
+		}
+
+		/*********************************************************************************
+		 * @brief Run without agents, counting the traffic they would see.
+		 * @note Replaces establishPort. Every task is computed in the clear by the primary,
+		 *       after building the same payloads it would send, and charged with the rounds
+		 *       and bytes the agents' protocol takes for it. The mesh is assumed up unless
+		 *       setAgentMesh(false) was called.
+		 *********************************************************************************/
+		void simulate() {
+			if (initialized) return;
+			simulated = true;
+			meshActive = meshEnabled;
+			initialized = true;
+			printMessage(std::string("Simulating agents") + (meshActive ? " with the mesh" : "") + "\n");
+		}
+
+		void pushCostSite(const std::string &label) {
+			costSites().push_back(label);
+		}
+
+		void popCostSite() {
+			if (!costSites().empty()) costSites().pop_back();
+		}
+
+		/*********************************************************************************
+		 * @brief Simulated costs so far, per call site and operation.
+		 *********************************************************************************/
+		std::vector<CostEntry> costBreakdown() const {
+			std::lock_guard<std::mutex> guard(wire);
+			std::vector<CostEntry> entries;
+			for (const auto &c : costs) {
+				entries.push_back({c.first.first, c.first.second, c.second});
+			}
+			return entries;
+		}
+
+		CostCounters totalCost() const {
+			std::lock_guard<std::mutex> guard(wire);
+			CostCounters total;
+			for (const auto &c : costs) {
+				total += c.second;
+			}
+			return total;
+		}
+
+		void resetCosts() {
+			std::lock_guard<std::mutex> guard(wire);
+			costs.clear();
+		}
+
+		/*********************************************************************************
+		 * @brief Have the agents connect to each other for renormalization and openings.
+		 * @note Every agent is sent the address and mesh port of all three, then reports
+		 *       whether it reached its peers. Only if all three did are they told to switch,
+		 *       so the agents always agree on where the next round goes.
+		 *********************************************************************************/
+		void connectMesh() {
+			std::vector<int32_t> peers(1 + 2 * 3);
+			for (int i = 0; i < 3; i++) {
+				struct sockaddr_in addr;
+				socklen_t addrLen = sizeof(addr);
+				if (replayBase) continue; // The agents' answers are in the transcript
+				if (meshPorts[i] <= 0 || getpeername(cli[i], (struct sockaddr *)&addr, &addrLen) != 0 || addr.sin_family != AF_INET) {
+					printMessage("Agent mesh unavailable, renormalizing through the primary\n");
+					return;
+				}
+				peers[1 + 2 * i] = static_cast<int32_t>(ntohl(addr.sin_addr.s_addr));
+				peers[2 + 2 * i] = meshPorts[i];
+			}
+			for (int i = 0; i < 3; i++) {
+				peers[0] = i + 1;
+				sendFrame(cli[i], OP_MESH | OP_BATCH, 0, peers);
+			}
+			bool ok = true;
+			for (int i = 0; i < 3; i++) {
+				frame_t hdr;
+				std::vector<int32_t> reply;
+				recvFrame(cli[i], hdr, reply);
+				ok = ok && hdr.op == (OP_MESH | OP_BATCH) && reply.size() == 1 && reply[0] == 1;
+			}
+			for (int i = 0; i < 3; i++) {
+				sendFrame(cli[i], OP_MESH | OP_BATCH, 0, std::vector<int32_t>{ok ? 1 : 0});
+			}
+			meshActive = ok;
+			printMessage(ok ? "Agent mesh active\n" : "Agent mesh failed, renormalizing through the primary\n");
+		}
+
+		/*********************************************************************************
+		 * @brief Disconnect from all agents and clean up resources.
+		 *********************************************************************************/
+		void disconnect() {
+			stopAutoBatch();
+			for (int i = 0; i < 3; i++) {
+				if (cli[i] != -1) {
+					close(cli[i]);
+					cli[i] = -1;
+				}
+				late[i].clear();
+				meshPorts[i] = 0;
+			}
+			keptRows = keptCols = 0;
+			keptValues.clear();
+			meshActive = false;
+			initialized = false;
+			simulated = false;
+			if (transcript) {
+				fclose(transcript);
+				transcript = nullptr;
+			}
+			if (replayBase) {
+				munmap(const_cast<char *>(replayBase), replaySize);
+				replayBase = nullptr;
+			}
+			printMessage("Disconnected from all agents\n");
+		}
+
+		/*********************************************************************************
+		 * @brief Run an addition operation with the MPC protocol.
+		 * @param int a: first operand
+		 * @param int b: second operand
+		 * @return int32_t: result of the addition
 		 *********************************************************************************/
-		int32_t runNE(int32_t a, int32_t b) {
-			return 1 - runEQ(a, b);
+		int32_t runAdd(int32_t a, int32_t b) {
+			std::lock_guard<std::mutex> guard(wire);
+			if (!initialized) throw std::logic_error("MPC context not initialized, need to add the following line before using a NetInt operation:\nestablishPort(\"1234567\");");
+
+			if (simulated) {
+				chargeScalar("ADD");
+				return addLocal(a, b);
+			}
+
+			int r1 = rand() % MOD;
+			int r2 = rand() % MOD;
+			uint8_t op = OP_ADD;
+
+			for (int i = 0; i < 3; i++) {
+				int32_t aShare = split(i, r1, a);
+				int32_t bShare = split(i, r2, b);
+				task_t t = {op, htonl(static_cast<uint32_t>(aShare)), htonl(static_cast<uint32_t>(bShare)), {0}, {0}};
+				sendAll(cli[i], &t, sizeof(t));
+			}
+
+			// The sum of two degree-1 sharings is degree 1, so two replies are enough
+			std::vector<int32_t> resultShares[3];
+			bool have[3] = {false, false, false};
+			int needed = (stragglerPolicy == StragglerPolicy::Wait) ? 3 : 2;
+			for (int got = 0; got < needed; got++) {
+				int i = got;
+				if (stragglerPolicy == StragglerPolicy::Wait) {
+					settleLate(i);
+				} else {
+					i = nextReadyAgent(have);
+				}
+				response_t r;
+				if (recvAll(cli[i], &r, sizeof(r)) != sizeof(r)) {
+					throw std::runtime_error("Agent disconnected during ADD");
+				}
+				if (r.op != OP_RES) {
+					throw std::runtime_error("Invalid ADD response");
+				}
+				resultShares[i].push_back(static_cast<int32_t>(ntohl(r.value)));
+				have[i] = true;
+			}
+			return reconstructResults(resultShares, have, false)[0];
+		}
+
+		/*********************************************************************************
+		 * @brief Control whether non-error messages are printed to console.
+		 * @param bool show: true to show messages, false to hide them
+		 *********************************************************************************/
+		void hideMessages(bool hide = true) {
+			showMessages = !hide;
+			if (!hide) {
+				printMessage("Non-error messages will be printed\n");
+			}
+		}
+
+		/*********************************************************************************
+		 * @brief Run a multiplication operation with the MPC protocol.
+		 * @param int a: first operand
+		 * @param int b: second operand
+		 * @return int32_t: result of the multiplication
+		 *********************************************************************************/
+		int32_t runMul(int32_t a, int32_t b) {
+			int32_t queued;
+			if (batching && enqueue(Queued::Mul, a, b, l, queued)) return queued;
+			std::lock_guard<std::mutex> guard(wire);
+			if (!initialized) throw std::logic_error("MPC context not initialized, need to add the following line before using a NetInt operation:\nestablishPort(\"1234567\");");
+
+			if (simulated) {
+				// The primary renormalizes scalar products itself, so there is no extra layer
+				chargeScalar("MUL");
+				return scaleLocal(a, b);
+			}
+
+			int32_t resultShares[3];
+			int r1 = rand() % MOD;
+			int r2 = rand() % MOD;
+			uint8_t op = OP_MUL;
+
+			for (int i = 0; i < 3; i++) {
+				int32_t aShare = split(i, r1, a);
+				int32_t bShare = split(i, r2, b);
+				task_t t = {op, htonl(static_cast<uint32_t>(aShare)), htonl(static_cast<uint32_t>(bShare)), {0}, {0}};
+				sendAll(cli[i], &t, sizeof(t));
+			}
+
+			for (int i = 0; i < 3; i++) {
+				settleLate(i);
+				response_t r;
+				if (recvAll(cli[i], &r, sizeof(r)) != sizeof(r)) {
+					throw std::runtime_error("Agent disconnected during MUL");
+				}
+				if (r.op != OP_RES) {
+					throw std::runtime_error("Invalid MUL response");
+				}
+				resultShares[i] = ntohl(r.value);
+			}
+			renormalize(resultShares);
+			return reconstruct(resultShares);
+		}
+
+		/*********************************************************************************
+		 * @brief Run a comparison operation with the MPC protocol, specifically the add functions.
+		 * @param int32_t a: first operand
+		 * @param int32_t b: second operand
+		 * @return int32_t: result of the comparison (0 or 1)
+		 *********************************************************************************/
+		int32_t runSub(int32_t a, int32_t b) {
+			// a - b = a + (MOD - b) mod MOD
+			return runAdd(a, (MOD - b) % MOD);
+		}
+
+		/*********************************************************************************
+		 * @brief Run less than comparison with the MPC protocol, specifically.
+		 * @param int32_t a: first operand
+		 * @param int32_t b: second operand
+		 * @param int width: bits compared, defaults to l
+		 * @return int32_t: result of the comparison (0 or 1)
+		 * @note Runs the batched OP_LT protocol on a single pair.
+		 *********************************************************************************/
+		int32_t runLT(int32_t a, int32_t b, int width = l) {
+			int32_t queued;
+			if (batching && enqueue(Queued::LT, a, b, width, queued)) return queued;
+			return runBatchLT({a}, {b}, width)[0];
+		}
+
+		/*********************************************************************************
+		 * @brief Run less than or equal to comparison with the MPC protocol.
+		 * @param int32_t a: first operand
+		 * @param int32_t b: second operand
+		 * @param int width: bits compared, defaults to l
+		 * @return int32_t: result of the comparison (0 or 1)
+		 *********************************************************************************/
+		int32_t runLE(int32_t a, int32_t b, int width = l) {
+			return 1 - runLT(b, a, width);
+		}
+
+		/*********************************************************************************
+		 * @brief Run greater than comparison with the MPC protocol.
+		 * @param int32_t a: first operand
+		 * @param int32_t b: second operand
+		 * @param int width: bits compared, defaults to l
+		 * @return int32_t: result of the comparison (0 or 1)
+		 *********************************************************************************/
+		int32_t runGT(int32_t a, int32_t b, int width = l) {
+			return runLT(b, a, width);
+		}
+
+		/*********************************************************************************
+		 * @brief Run greater than or equal to comparison with the MPC protocol.
+		 * @param int32_t a: first operand
+		 * @param int32_t b: second operand
+		 * @param int width: bits compared, defaults to l
+		 * @return int32_t: result of the comparison (0 or 1)
+		 *********************************************************************************/
+		int32_t runGE(int32_t a, int32_t b, int width = l) {
+			return runLE(b, a, width);
+		}
+
+		/*********************************************************************************
+		 * @brief Run equality comparison with the MPC protocol.
+		 * @param int32_t a: first operand
+		 * @param int32_t b: second operand
+		 * @param int width: bits compared, defaults to l
+		 * @return int32_t: result of the comparison (0 or 1)
+		 * @note Uses the dedicated OP_EQL protocol rather than OP_CMP.
+		 *********************************************************************************/
+		int32_t runEQ(int32_t a, int32_t b, int width = l) {
+			int32_t queued;
+			if (batching && enqueue(Queued::EQ, a, b, width, queued)) return queued;
+			return runBatchEQ({a}, {b}, width)[0];
+		}
+
+		/*********************************************************************************
+		 * @brief Run not equal to comparison with the MPC protocol.
+		 * @param int32_t a: first operand
+		 * @param int32_t b: second operand
+		 * @param int width: bits compared, defaults to l
+		 * @return int32_t: result of the comparison (0 or 1)
+		 *********************************************************************************/
+		int32_t runNE(int32_t a, int32_t b, int width = l) {
+			return 1 - runEQ(a, b, width);
+		}
+
+		/*********************************************************************************
+		 * @brief Run many less than comparisons of secrets against public constants.
+		 * @param const std::vector<int32_t> &a: secret operands
+		 * @param const std::vector<int32_t> &c: public constants
+		 * @param int width: bits per operand, defaults to l
+		 * @return std::vector<int32_t>: a[i] < c[i] for each i (0 or 1)
+		 * @note Only the bits of a are shared. The constants travel as plain values, and
+		 *       with their bits known the per-bit eq and lt terms need no renormalization.
+		 *********************************************************************************/
+		std::vector<int32_t> runBatchLTPublic(const std::vector<int32_t> &a, const std::vector<int32_t> &c, int width = l) {
+			std::lock_guard<std::mutex> guard(wire);
+			std::vector<int32_t> payload[3];
+			for (size_t i = 0; i < a.size(); i++) {
+				splitBitsInto(a[i], width, payload);
+			}
+			for (int j = 0; j < 3; j++) {
+				payload[j].insert(payload[j].end(), c.begin(), c.end());
+			}
+			uint8_t op = withBackend(OP_LTC, width, a.size() * width, payload);
+			return runBatch(op, static_cast<uint8_t>(width), payload);
+		}
+
+		/*********************************************************************************
+		 * @brief Run many equality comparisons of secrets against public constants.
+		 * @param const std::vector<int32_t> &a: secret operands
+		 * @param const std::vector<int32_t> &c: public constants
+		 * @param int width: bits per operand, defaults to l
+		 * @return std::vector<int32_t>: a[i] == c[i] for each i (0 or 1)
+		 *********************************************************************************/
+		std::vector<int32_t> runBatchEQPublic(const std::vector<int32_t> &a, const std::vector<int32_t> &c, int width = l) {
+			std::lock_guard<std::mutex> guard(wire);
+			std::vector<int32_t> payload[3];
+			for (size_t i = 0; i < a.size(); i++) {
+				splitBitsInto(a[i], width, payload);
+			}
+			for (int j = 0; j < 3; j++) {
+				payload[j].insert(payload[j].end(), c.begin(), c.end());
+			}
+			uint8_t op = withBackend(OP_EQC, width, a.size(), payload);
+			return runBatch(op, static_cast<uint8_t>(width), payload);
+		}
+
+		/*********************************************************************************
+		 * @brief Count how many secrets are less than their public constants.
+		 * @param const std::vector<int32_t> &a: secret operands
+		 * @param const std::vector<int32_t> &c: public constants
+		 * @param int width: bits per operand, defaults to l
+		 * @return int32_t: number of i with a[i] < c[i]
+		 * @note Agents sum the comparison outputs on their shares, so only the count is revealed.
+		 *********************************************************************************/
+		int32_t runCountLTPublic(const std::vector<int32_t> &a, const std::vector<int32_t> &c, int width = l) {
+			std::lock_guard<std::mutex> guard(wire);
+			if (a.empty()) return 0;
+			std::vector<int32_t> payload[3];
+			for (size_t i = 0; i < a.size(); i++) {
+				splitBitsInto(a[i], width, payload);
+			}
+			for (int j = 0; j < 3; j++) {
+				payload[j].insert(payload[j].end(), c.begin(), c.end());
+			}
+			uint8_t op = withBackend(OP_LTC, width, a.size() * width, payload);
+			return runBatch(op, static_cast<uint8_t>(width) | WIDTH_SUM, payload)[0];
+		}
+
+		/*********************************************************************************
+		 * @brief Count how many secrets equal their public constants.
+		 * @param const std::vector<int32_t> &a: secret operands
+		 * @param const std::vector<int32_t> &c: public constants
+		 * @param int width: bits per operand, defaults to l
+		 * @return int32_t: number of i with a[i] == c[i]
+		 *********************************************************************************/
+		int32_t runCountEQPublic(const std::vector<int32_t> &a, const std::vector<int32_t> &c, int width = l) {
+			std::lock_guard<std::mutex> guard(wire);
+			if (a.empty()) return 0;
+			std::vector<int32_t> payload[3];
+			for (size_t i = 0; i < a.size(); i++) {
+				splitBitsInto(a[i], width, payload);
+			}
+			for (int j = 0; j < 3; j++) {
+				payload[j].insert(payload[j].end(), c.begin(), c.end());
+			}
+			uint8_t op = withBackend(OP_EQC, width, a.size(), payload);
+			return runBatch(op, static_cast<uint8_t>(width) | WIDTH_SUM, payload)[0];
+		}
+
+		/*********************************************************************************
+		 * @brief Run less than comparison of a secret against a public constant.
+		 * @param int32_t a: secret operand
+		 * @param int32_t c: public constant
+		 * @param int width: bits compared, defaults to l
+		 * @return int32_t: result of the comparison (0 or 1)
+		 *********************************************************************************/
+		int32_t runLTPublic(int32_t a, int32_t c, int width = l) {
+			int32_t queued;
+			if (batching && enqueue(Queued::LTPublic, a, c, width, queued)) return queued;
+			return runBatchLTPublic({a}, {c}, width)[0];
+		}
+
+		/*********************************************************************************
+		 * @brief Run less than or equal to comparison of a secret against a public constant.
+		 * @param int32_t a: secret operand
+		 * @param int32_t c: public constant
+		 * @param int width: bits compared, defaults to l
+		 * @return int32_t: result of the comparison (0 or 1)
+		 * @note a <= c is a < c + 1, which is always true when c is the largest width-bit value.
+		 *********************************************************************************/
+		int32_t runLEPublic(int32_t a, int32_t c, int width = l) {
+			int32_t low = c & ((1 << width) - 1);
+			if (low == (1 << width) - 1) return 1;
+			return runLTPublic(a, low + 1, width);
+		}
+
+		/*********************************************************************************
+		 * @brief Run greater than comparison of a secret against a public constant.
+		 * @param int32_t a: secret operand
+		 * @param int32_t c: public constant
+		 * @param int width: bits compared, defaults to l
+		 * @return int32_t: result of the comparison (0 or 1)
+		 *********************************************************************************/
+		int32_t runGTPublic(int32_t a, int32_t c, int width = l) {
+			return 1 - runLEPublic(a, c, width);
+		}
+
+		/*********************************************************************************
+		 * @brief Run greater than or equal to comparison of a secret against a public constant.
+		 * @param int32_t a: secret operand
+		 * @param int32_t c: public constant
+		 * @param int width: bits compared, defaults to l
+		 * @return int32_t: result of the comparison (0 or 1)
+		 *********************************************************************************/
+		int32_t runGEPublic(int32_t a, int32_t c, int width = l) {
+			return 1 - runLTPublic(a, c, width);
+		}
+
+		/*********************************************************************************
+		 * @brief Run equality comparison of a secret against a public constant.
+		 * @param int32_t a: secret operand
+		 * @param int32_t c: public constant
+		 * @param int width: bits compared, defaults to l
+		 * @return int32_t: result of the comparison (0 or 1)
+		 *********************************************************************************/
+		int32_t runEQPublic(int32_t a, int32_t c, int width = l) {
+			int32_t queued;
+			if (batching && enqueue(Queued::EQPublic, a, c, width, queued)) return queued;
+			return runBatchEQPublic({a}, {c}, width)[0];
+		}
+
+		/*********************************************************************************
+		 * @brief Run not equal to comparison of a secret against a public constant.
+		 * @param int32_t a: secret operand
+		 * @param int32_t c: public constant
+		 * @param int width: bits compared, defaults to l
+		 * @return int32_t: result of the comparison (0 or 1)
+		 *********************************************************************************/
+		int32_t runNEPublic(int32_t a, int32_t c, int width = l) {
+			return 1 - runEQPublic(a, c, width);
+		}
+
+		/*********************************************************************************
+		 * @brief Run many less than comparisons as one batched task.
+		 * @param const std::vector<int32_t> &a: first operands
+		 * @param const std::vector<int32_t> &b: second operands
+		 * @param int width: bits per operand, defaults to l
+		 * @return std::vector<int32_t>: a[i] < b[i] for each i (0 or 1)
+		 * @note All comparisons share the same rounds: one for the bit products, a log-depth
+		 *       prefix product over the equality bits, and one for the final flags. The
+		 *       preprocessed backend replaces the prefix product with one masked zero-test
+		 *       opening, three rounds for any width.
+		 *********************************************************************************/
+		std::vector<int32_t> runBatchLT(const std::vector<int32_t> &a, const std::vector<int32_t> &b, int width = l) {
+			std::lock_guard<std::mutex> guard(wire);
+			std::vector<int32_t> payload[3];
+			for (size_t i = 0; i < a.size(); i++) {
+				splitBitsInto(a[i], width, payload);
+			}
+			for (size_t i = 0; i < b.size(); i++) {
+				splitBitsInto(b[i], width, payload);
+			}
+			uint8_t op = withBackend(OP_LT, width, a.size() * width, payload);
+			return runBatch(op, static_cast<uint8_t>(width), payload);
+		}
+
+		/*********************************************************************************
+		 * @brief Run many equality comparisons as one batched task.
+		 * @param const std::vector<int32_t> &a: first operands
+		 * @param const std::vector<int32_t> &b: second operands
+		 * @param int width: bits per operand, defaults to l
+		 * @return std::vector<int32_t>: a[i] == b[i] for each i (0 or 1)
+		 * @note Agents multiply the per-bit XNORs in a log-depth product tree: one round for
+		 *       the bit products plus ceil(log2(width)) rounds, instead of the 5l - 1 of OP_CMP.
+		 *       The preprocessed backend zero-tests the count of differing bits instead, two
+		 *       rounds for any width.
+		 *********************************************************************************/
+		std::vector<int32_t> runBatchEQ(const std::vector<int32_t> &a, const std::vector<int32_t> &b, int width = l) {
+			std::lock_guard<std::mutex> guard(wire);
+			std::vector<int32_t> payload[3];
+			for (size_t i = 0; i < a.size(); i++) {
+				splitBitsInto(a[i], width, payload);
+			}
+			for (size_t i = 0; i < b.size(); i++) {
+				splitBitsInto(b[i], width, payload);
+			}
+			uint8_t op = withBackend(OP_EQL, width, a.size(), payload);
+			return runBatch(op, static_cast<uint8_t>(width), payload);
+		}
+
+		/*********************************************************************************
+		 * @brief Run many multiplications as one batched task with a single renormalization round.
+		 * @param const std::vector<int32_t> &a: first operands
+		 * @param const std::vector<int32_t> &b: second operands
+		 * @return std::vector<int32_t>: a[i] * b[i] for each i
+		 *********************************************************************************/
+		std::vector<int32_t> runBatchMul(const std::vector<int32_t> &a, const std::vector<int32_t> &b) {
+			std::lock_guard<std::mutex> guard(wire);
+			std::vector<int32_t> payload[3];
+			for (size_t i = 0; i < a.size(); i++) {
+				splitInto(a[i], payload);
+			}
+			for (size_t i = 0; i < b.size(); i++) {
+				splitInto(b[i], payload);
+			}
+			return runBatch(OP_MUL, l, payload);
+		}
+
+		/*********************************************************************************
+		 * @brief Multiply two matrices as one batched task.
+		 * @param const std::vector<int32_t> &a: n x k matrix, row major
+		 * @param const std::vector<int32_t> &b: k x m matrix, row major
+		 * @param uint32_t n: rows of a
+		 * @param uint32_t k: columns of a and rows of b
+		 * @param uint32_t m: columns of b
+		 * @return std::vector<int32_t>: n x m product, row major
+		 * @note Each agent sums the share products of an output locally, so all n*m outputs
+		 *       need a single renormalization round between them.
+		 *********************************************************************************/
+		std::vector<int32_t> runBatchMatMul(const std::vector<int32_t> &a, const std::vector<int32_t> &b, uint32_t n, uint32_t k, uint32_t m) {
+			// An empty product is all zeros and needs no agents
+			if (static_cast<uint64_t>(n) * m * k == 0) return std::vector<int32_t>(static_cast<size_t>(n) * m, 0);
+			std::lock_guard<std::mutex> guard(wire);
+			std::vector<int32_t> payload[3];
+			for (int j = 0; j < 3; j++) {
+				payload[j].reserve(3 + a.size() + b.size());
+				payload[j].push_back(static_cast<int32_t>(n));
+				payload[j].push_back(static_cast<int32_t>(k));
+				payload[j].push_back(static_cast<int32_t>(m));
+			}
+			for (size_t i = 0; i < a.size(); i++) {
+				splitInto(a[i], payload);
+			}
+			for (size_t i = 0; i < b.size(); i++) {
+				splitInto(b[i], payload);
+			}
+			return runBatch(OP_DOT, l, payload);
+		}
+
+		/*********************************************************************************
+		 * @brief Deal a matrix once for the agents to keep as the right operand of later
+		 *        products, replacing the one kept before.
+		 * @param const std::vector<int32_t> &b: k x m matrix, row major
+		 * @param uint32_t k: rows
+		 * @param uint32_t m: columns
+		 * @note The agents do not reply, so this is one frame per agent and no round.
+		 *********************************************************************************/
+		void runKeepMatrix(const std::vector<int32_t> &b, uint32_t k, uint32_t m) {
+			std::lock_guard<std::mutex> guard(wire);
+			if (!initialized) throw std::logic_error("MPC context not initialized, need to add the following line before using a NetInt operation:\nestablishPort(\"1234567\");");
+			std::vector<int32_t> payload[3];
+			for (int j = 0; j < 3; j++) {
+				payload[j].reserve(2 + b.size());
+				payload[j].push_back(static_cast<int32_t>(k));
+				payload[j].push_back(static_cast<int32_t>(m));
+			}
+			for (size_t i = 0; i < b.size(); i++) {
+				splitInto(b[i], payload);
+			}
+			const uint8_t width = packedWidth(payload);
+			keptRows = k;
+			keptCols = m;
+			if (simulated) {
+				keptValues = b;
+				CostCounters &cost = costOf("KEEP");
+				cost.messages++;
+				cost.bytes += sizeof(frame_t) + wireBytes(payload[0].size(), width != 0);
+				return;
+			}
+			for (int i = 0; i < 3; i++) {
+				sendFrame(cli[i], OP_KEEP | OP_BATCH, width, payload[i]);
+			}
+		}
+
+		/*********************************************************************************
+		 * @brief Multiply a matrix by the one the agents keep, as one batched task.
+		 * @param const std::vector<int32_t> &a: n x keptRows matrix, row major
+		 * @param uint32_t n: rows of a
+		 * @return std::vector<int32_t>: n x keptCols product, row major
+		 * @note Only a travels, so repeated products with the same right operand cost
+		 *       O(n * k) values per task instead of O(n * k + k * m).
+		 *********************************************************************************/
+		std::vector<int32_t> runBatchMatMulKept(const std::vector<int32_t> &a, uint32_t n) {
+			std::lock_guard<std::mutex> guard(wire);
+			if (static_cast<uint64_t>(n) * keptRows * keptCols == 0) return std::vector<int32_t>(static_cast<size_t>(n) * keptCols, 0);
+			std::vector<int32_t> payload[3];
+			for (int j = 0; j < 3; j++) {
+				payload[j].reserve(3 + a.size());
+				payload[j].push_back(static_cast<int32_t>(n));
+				payload[j].push_back(static_cast<int32_t>(keptRows));
+				payload[j].push_back(static_cast<int32_t>(keptCols));
+			}
+			for (size_t i = 0; i < a.size(); i++) {
+				splitInto(a[i], payload);
+			}
+			return runBatch(OP_DOT | OP_STORE, l, payload);
+		}
+
+		/*********************************************************************************
+		 * @brief Add two values without contacting the agents.
+		 * @param int32_t a: first operand
+		 * @param int32_t b: second operand
+		 * @return int32_t: (a + b) mod MOD
+		 * @note Shares are degree-1 polynomials, so each agent would only add its two shares.
+		 *       Reconstructing that sum always yields a + b, so the round trip is skipped.
+		 *********************************************************************************/
+		int32_t addLocal(int32_t a, int32_t b) const {
+			int64_t sum = (static_cast<int64_t>(a) + b) % MOD;
+			return static_cast<int32_t>((sum < 0) ? sum + MOD : sum);
+		}
+
+		/*********************************************************************************
+		 * @brief Subtract two values without contacting the agents.
+		 * @param int32_t a: first operand
+		 * @param int32_t b: second operand
+		 * @return int32_t: (a - b) mod MOD
+		 *********************************************************************************/
+		int32_t subLocal(int32_t a, int32_t b) const {
+			return addLocal(a, -(b % MOD));
+		}
+
+		/*********************************************************************************
+		 * @brief Multiply a secret by a public constant without contacting the agents.
+		 * @param int32_t a: secret operand
+		 * @param int32_t c: public constant
+		 * @return int32_t: (a * c) mod MOD
+		 * @note Scaling every share by c keeps the polynomial at degree 1, so no
+		 *       renormalization is needed. Only secret-by-secret products use runMul.
+		 *********************************************************************************/
+		int32_t scaleLocal(int32_t a, int32_t c) const {
+			int64_t prod = (static_cast<int64_t>(a) % MOD) * (c % MOD) % MOD;
+			return static_cast<int32_t>((prod < 0) ? prod + MOD : prod);
+		}
+
+	private:
+		void printMessage(const std::string &msg) const {
+			if (showMessages) {
+				std::cout << msg;
+			}
+		}
+	};
+
+	std::unique_ptr<NetIntContext> NetIntContext::instance;
+}
+
+/*********************************************************************************
+ * @brief Public API for the NetInt library. Functions and structures beyond this point are intended to be interacted with.
+ * This provides convenience functions to establish connections, disconnect agents,
+ * and manage IP whitelists.
+ *********************************************************************************/
+namespace detail {
+	class NetIntContext;
+}
+void establishPort(const std::string &port);
+void disconnectAgents();
+void setWhitelist(const std::vector<std::string> &allowedIPs);
+void clearWhitelist();
+void hideMessages(bool hide = true);
+using CompareBackend = detail::CompareBackend;
+using StragglerPolicy = detail::StragglerPolicy;
+void setComparisonBackend(CompareBackend backend);
+void setStragglerPolicy(StragglerPolicy policy);
+void setAgentMesh(bool enable);
+void setPackedFrames(bool enable);
+void recordTranscript(const std::string &path);
+void replayTranscript(const std::string &path);
+void preprocessComparisons(size_t count, int width = detail::l);
+using CostCounters = detail::CostCounters;
+using CostEntry = detail::CostEntry;
+void enableAutoBatch(size_t maxBatch = 256, uint32_t windowMicros = 100, size_t maxPending = 0);
+void disableAutoBatch();
+void simulateAgents();
+CostCounters simulatedCost();
+std::vector<CostEntry> costBreakdown();
+void printCostReport(std::ostream &os = std::cout);
+void resetCosts();
+
+inline void establishPort(const std::string &port) {
+	detail::NetIntContext::getInstance().socket(port);
+}
+
+inline void disconnectAgents() {
+	detail::NetIntContext::getInstance().disconnect();
+}
+
+inline void setWhitelist(const std::vector<std::string> &allowedIPs) {
+	detail::NetIntContext::getInstance().setIPWhitelist(allowedIPs);
+}
+
+inline void clearWhitelist() {
+	detail::NetIntContext::getInstance().clearIPWhitelist();
+}
+
+inline void hideMessages(bool hide) {
+	detail::NetIntContext::getInstance().hideMessages(hide);
+}
+
+inline void setComparisonBackend(CompareBackend backend) {
+	detail::NetIntContext::getInstance().setComparisonBackend(backend);
+}
+
+inline void setStragglerPolicy(StragglerPolicy policy) {
+	detail::NetIntContext::getInstance().setStragglerPolicy(policy);
+}
+
+inline void setAgentMesh(bool enable) {
+	detail::NetIntContext::getInstance().setAgentMesh(enable);
+}
+
+inline void setPackedFrames(bool enable) {
+	detail::NetIntContext::getInstance().setPackedFrames(enable);
+}
+
+inline void recordTranscript(const std::string &path) {
+	detail::NetIntContext::getInstance().recordTranscript(path);
+}
+
+inline void replayTranscript(const std::string &path) {
+	detail::NetIntContext::getInstance().replayTranscript(path);
+}
+
+inline void preprocessComparisons(size_t count, int width) {
+	detail::NetIntContext::getInstance().preprocessComparisons(count, width);
+}
+
+inline void enableAutoBatch(size_t maxBatch, uint32_t windowMicros, size_t maxPending) {
+	detail::NetIntContext::getInstance().startAutoBatch(maxBatch, windowMicros, maxPending);
+}
+
+inline void disableAutoBatch() {
+	detail::NetIntContext::getInstance().stopAutoBatch();
+}
+
+inline void simulateAgents() {
+	detail::NetIntContext::getInstance().simulate();
+}
+
+inline CostCounters simulatedCost() {
+	return detail::NetIntContext::getInstance().totalCost();
+}
+
+inline std::vector<CostEntry> costBreakdown() {
+	return detail::NetIntContext::getInstance().costBreakdown();
+}
+
+inline void resetCosts() {
+	detail::NetIntContext::getInstance().resetCosts();
+}
+
+/*********************************************************************************
+ * @brief Print the simulated costs as a table, one row per call site and operation.
+ * @param std::ostream &os: destination, defaults to std::cout
+ *********************************************************************************/
+inline void printCostReport(std::ostream &os) {
+	size_t siteWidth = 4, opWidth = 2;
+	std::vector<CostEntry> entries = costBreakdown();
+	for (const CostEntry &e : entries) {
+		siteWidth = std::max(siteWidth, e.site.size());
+		opWidth = std::max(opWidth, e.op.size());
+	}
+	auto row = [&](const std::string &site, const std::string &op, const std::string &tasks, const std::string &rounds, const std::string &messages, const std::string &bytes) {
+		os << site << std::string(siteWidth - site.size() + 2, ' ') << op << std::string(opWidth - op.size() + 2, ' ');
+		for (const std::string *col : {&tasks, &rounds, &messages, &bytes}) {
+			os << std::string(col->size() < 12 ? 12 - col->size() : 1, ' ') << *col;
+		}
+		os << "\n";
+	};
+	row("site", "op", "tasks", "rounds", "messages", "bytes");
+	for (const CostEntry &e : entries) {
+		row(e.site.empty() ? "-" : e.site, e.op, std::to_string(e.cost.tasks), std::to_string(e.cost.rounds), std::to_string(e.cost.messages), std::to_string(e.cost.bytes));
+	}
+	CostCounters total = simulatedCost();
+	row("total", "", std::to_string(total.tasks), std::to_string(total.rounds), std::to_string(total.messages), std::to_string(total.bytes));
+}
+
+/*********************************************************************************
+ * @brief Attribute simulated costs to a call site for as long as the scope lives.
+ * Scopes nest, and their labels join with '/'. Without a label the scope is named after
+ * the file and line that opened it. Scopes belong to the thread that opens them, and an
+ * operation handed to the auto-batcher is charged to the scope it was queued from.
+ *********************************************************************************/
+class CostScope {
+public:
+	explicit CostScope(const char *label = nullptr, const char *file = __builtin_FILE(), int line = __builtin_LINE()) {
+		std::string name = label ? label : std::string(file) + ":" + std::to_string(line);
+		detail::NetIntContext::getInstance().pushCostSite(name);
+	}
+	~CostScope() {
+		detail::NetIntContext::getInstance().popCostSite();
+	}
+	CostScope(const CostScope &) = delete;
+	CostScope &operator=(const CostScope &) = delete;
+};
+
+/*********************************************************************************
+ * @brief Lint mode for secret values that only drive control flow.
+ * Define NETINT_LINT before including this header to get a deprecation warning wherever
+ * a NetInt is incremented, decremented, or converted to a plain int (loop counters and
+ * array indices). Add -Werror=deprecated-declarations to turn the warnings into errors.
+ *********************************************************************************/
+#ifdef NETINT_LINT
+#define NETINT_CONTROL_FLOW [[deprecated("NetInt used for control flow, declare it as PublicInt")]]
+#else
+#define NETINT_CONTROL_FLOW
+#endif
+
+struct NetInt;
+struct PublicInt;
+
+namespace detail {
+	template <size_t P>
+	struct ProductSum;
+
+	// Enables an overload only for public operands: plain arithmetic types or PublicInt
+	template <typename T>
+	using IfPublic = typename std::enable_if<std::is_arithmetic<T>::value || std::is_same<T, PublicInt>::value, int>::type;
+}
+
+namespace detail {
+	/*********************************************************************************
+	 * @brief Read the raw value of an operand without going through NetInt's int conversion.
+	 * @param const T &operand: public value, NetInt, or PublicInt
+	 * @return int32_t: operand value
+	 *********************************************************************************/
+	template <typename T>
+	int32_t operandValue(const T &operand) {
+		return static_cast<int32_t>(operand);
+	}
+	int32_t operandValue(const NetInt &operand);
+
+	const int32_t NO_BOUND = -1;
+
+	/*********************************************************************************
+	 * @brief Bound implied by a public constant: the constant itself when it lies in [0, MOD).
+	 * @param int32_t c: public constant
+	 * @return int32_t: upper bound, or NO_BOUND
+	 *********************************************************************************/
+	inline int32_t constantBound(int32_t c) {
+		return (c >= 0 && c < MOD) ? c : NO_BOUND;
+	}
+
+	/*********************************************************************************
+	 * @brief Known upper bound of an operand.
+	 * @param const T &operand: public value, NetInt, or PublicInt
+	 * @return int32_t: upper bound, or NO_BOUND
+	 *********************************************************************************/
+	template <typename T>
+	int32_t operandBound(const T &operand) {
+		return constantBound(static_cast<int32_t>(operand));
+	}
+	int32_t operandBound(const NetInt &operand);
+
+	/*********************************************************************************
+	 * @brief Bound of a sum, kept only while the sum cannot wrap around MOD.
+	 *********************************************************************************/
+	inline int32_t sumBound(int32_t a, int32_t b) {
+		if (a == NO_BOUND || b == NO_BOUND || static_cast<int64_t>(a) + b >= MOD) return NO_BOUND;
+		return a + b;
+	}
+
+	/*********************************************************************************
+	 * @brief Bound of a product, kept only while the product cannot wrap around MOD.
+	 *********************************************************************************/
+	inline int32_t productBound(int32_t a, int32_t b) {
+		if (a == NO_BOUND || b == NO_BOUND || static_cast<int64_t>(a) * b >= MOD) return NO_BOUND;
+		return a * b;
+	}
+
+	/*********************************************************************************
+	 * @brief Number of bits a comparison between two bounded operands needs.
+	 * @param int32_t a: bound of the first operand
+	 * @param int32_t b: bound of the second operand
+	 * @return int: bits covering max(a, b), or l if either bound is unknown
+	 *********************************************************************************/
+	inline int compareWidth(int32_t a, int32_t b) {
+		if (a == NO_BOUND || b == NO_BOUND) return l;
+		int32_t top = std::max(a, b);
+		int width = 1;
+		while (width < l && (top >> width) != 0) width++;
+		return width;
+	}
+}
+
+struct NetInt {
+	int32_t value;
+	int32_t bound; // Known upper bound on value, or detail::NO_BOUND
+
+	// A plain int becomes a secret, so it carries no bound: comparison widths would reveal
+	// its bit length. Bounds come from PublicInt, an explicit bound, or the input loaders.
+	NetInt(int32_t val = 0) : value(val), bound(detail::NO_BOUND) {}
+	NetInt(int32_t val, int32_t maxValue) : value(val), bound(maxValue) {}
+	NetInt(const PublicInt &val);
+	NetInt(const NetInt &other) = default;
+	NetInt &operator=(const NetInt &other) = default;
+	NetInt &operator=(int32_t val) {
+		value = val;
+		bound = detail::NO_BOUND;
+		return *this;
+	}
+	NetInt &operator=(const PublicInt &val);
+
+	// Disable division, modulo, and bitwise operators
+	NetInt operator/(const NetInt &) const = delete;
+	NetInt operator/(int32_t) const = delete;
+	NetInt &operator/=(const NetInt &) = delete;
+	NetInt &operator/=(int32_t) = delete;
+
+	NetInt operator%(const NetInt &) const = delete;
+	NetInt operator%(int32_t) const = delete;
+	NetInt &operator%=(const NetInt &) = delete;
+	NetInt &operator%=(int32_t) = delete;
+
+	NetInt operator&(const NetInt &other) const = delete;
+	NetInt operator|(const NetInt &other) const = delete;
+	NetInt operator^(const NetInt &other) const = delete;
+	NetInt operator~() const = delete;
+
+	friend void swap(NetInt &a, NetInt &b) noexcept {
+		std::swap(a.value, b.value);
+		std::swap(a.bound, b.bound);
+	}
+
+	/*********************************************************************************
+	 * @brief Declare a known upper bound so comparisons only decompose ceil(log2(bound + 1)) bits.
+	 * @param int32_t maxValue: largest value this NetInt can hold
+	 * @return NetInt&: this NetInt
+	 * @note Results are wrong if the value ever exceeds the declared bound.
+	 *********************************************************************************/
+	NetInt &setBound(int32_t maxValue) {
+		bound = (maxValue >= 0 && maxValue < detail::MOD) ? maxValue : detail::NO_BOUND;
+		return *this;
+	}
+	int32_t getBound() const { return bound; }
+
+	// Working Arithmetic operators
+	// Addition, subtraction, and multiplication by a public (non-NetInt) value are linear
+	// in the shares and are evaluated locally. Only NetInt * NetInt reaches the agents.
+	// Bounds follow sums and products while they stay below MOD; subtraction may wrap and drops them.
+	template <typename T>
+	NetInt operator+(const T &other) const {
+		return NetInt(detail::NetIntContext::getInstance().addLocal(value, detail::operandValue(other)), detail::sumBound(bound, detail::operandBound(other)));
+	}
+	template <typename T>
+	NetInt operator-(const T &other) const {
+		return NetInt(detail::NetIntContext::getInstance().subLocal(value, detail::operandValue(other)), detail::NO_BOUND);
+	}
+	template <typename T>
+	NetInt operator*(const T &other) const {
+		return NetInt(detail::NetIntContext::getInstance().scaleLocal(value, detail::operandValue(other)), detail::productBound(bound, detail::operandBound(other)));
+	}
+	// NetInt * NetInt is not run on its own: it starts a detail::ProductSum, which collects
+	// further products and sums and runs them all in one task when converted back to NetInt
+	detail::ProductSum<1> operator*(const NetInt &other) const;
+	template <size_t P>
+	detail::ProductSum<P> operator+(const detail::ProductSum<P> &other) const {
+		return other + *this;
+	}
+	template <size_t P>
+	detail::ProductSum<P> operator-(const detail::ProductSum<P> &other) const {
+		return -other + *this;
+	}
+	template <size_t P>
+	detail::ProductSum<1> operator*(const detail::ProductSum<P> &other) const;
+
+	// Compound assignment operators
+	template <typename T>
+	NetInt &operator+=(const T &other) {
+		value = detail::NetIntContext::getInstance().addLocal(value, detail::operandValue(other));
+		bound = detail::sumBound(bound, detail::operandBound(other));
+		return *this;
+	}
+	template <typename T>
+	NetInt &operator-=(const T &other) {
+		value = detail::NetIntContext::getInstance().subLocal(value, detail::operandValue(other));
+		bound = detail::NO_BOUND;
+		return *this;
+	}
+	template <typename T>
+	NetInt &operator*=(const T &other) {
+		value = detail::NetIntContext::getInstance().scaleLocal(value, detail::operandValue(other));
+		bound = detail::productBound(bound, detail::operandBound(other));
+		return *this;
+	}
+	NetInt &operator*=(const NetInt &other) {
+		value = detail::NetIntContext::getInstance().runMul(value, other.value);
+		bound = detail::productBound(bound, other.bound);
+		return *this;
+	}
+	template <size_t P>
+	NetInt &operator+=(const detail::ProductSum<P> &other) {
+		return *this = (other + *this).evaluate();
+	}
+	template <size_t P>
+	NetInt &operator-=(const detail::ProductSum<P> &other) {
+		return *this = (-other + *this).evaluate();
+	}
+	template <size_t P>
+	NetInt &operator*=(const detail::ProductSum<P> &other) {
+		return *this *= other.evaluate();
+	}
+
+	// Comparison operators
+	// Comparing against a public (non-NetInt) value only shares this operand's bits.
+	// Known bounds on both sides shrink the number of bits compared.
+	template <typename T>
+	bool operator<(const T &other) const {
+		return detail::NetIntContext::getInstance().runLTPublic(value, detail::operandValue(other), detail::compareWidth(bound, detail::operandBound(other))) == 1;
+	}
+	template <typename T>
+	bool operator<=(const T &other) const {
+		return detail::NetIntContext::getInstance().runLEPublic(value, detail::operandValue(other), detail::compareWidth(bound, detail::operandBound(other))) == 1;
+	}
+	template <typename T>
+	bool operator>(const T &other) const {
+		return detail::NetIntContext::getInstance().runGTPublic(value, detail::operandValue(other), detail::compareWidth(bound, detail::operandBound(other))) == 1;
+	}
+	template <typename T>
+	bool operator>=(const T &other) const {
+		return detail::NetIntContext::getInstance().runGEPublic(value, detail::operandValue(other), detail::compareWidth(bound, detail::operandBound(other))) == 1;
+	}
+	template <typename T>
+	bool operator==(const T &other) const {
+		return detail::NetIntContext::getInstance().runEQPublic(value, detail::operandValue(other), detail::compareWidth(bound, detail::operandBound(other))) == 1;
+	}
+	template <typename T>
+	bool operator!=(const T &other) const {
+		return detail::NetIntContext::getInstance().runNEPublic(value, detail::operandValue(other), detail::compareWidth(bound, detail::operandBound(other))) == 1;
+	}
+	bool operator<(const NetInt &other) const {
+		return detail::NetIntContext::getInstance().runLT(value, other.value, detail::compareWidth(bound, other.bound)) == 1;
+	}
+	bool operator<=(const NetInt &other) const {
+		return detail::NetIntContext::getInstance().runLE(value, other.value, detail::compareWidth(bound, other.bound)) == 1;
+	}
+	bool operator>(const NetInt &other) const {
+		return detail::NetIntContext::getInstance().runGT(value, other.value, detail::compareWidth(bound, other.bound)) == 1;
+	}
+	bool operator>=(const NetInt &other) const {
+		return detail::NetIntContext::getInstance().runGE(value, other.value, detail::compareWidth(bound, other.bound)) == 1;
+	}
+	bool operator==(const NetInt &other) const {
+		return detail::NetIntContext::getInstance().runEQ(value, other.value, detail::compareWidth(bound, other.bound)) == 1;
+	}
+	bool operator!=(const NetInt &other) const {
+		return detail::NetIntContext::getInstance().runNE(value, other.value, detail::compareWidth(bound, other.bound)) == 1;
+	}
+	template <size_t P>
+	bool operator<(const detail::ProductSum<P> &other) const { return *this < other.evaluate(); }
+	template <size_t P>
+	bool operator<=(const detail::ProductSum<P> &other) const { return *this <= other.evaluate(); }
+	template <size_t P>
+	bool operator>(const detail::ProductSum<P> &other) const { return *this > other.evaluate(); }
+	template <size_t P>
+	bool operator>=(const detail::ProductSum<P> &other) const { return *this >= other.evaluate(); }
+	template <size_t P>
+	bool operator==(const detail::ProductSum<P> &other) const { return *this == other.evaluate(); }
+	template <size_t P>
+	bool operator!=(const detail::ProductSum<P> &other) const { return *this != other.evaluate(); }
+
+	NETINT_CONTROL_FLOW NetInt &operator++() {
+		value = detail::NetIntContext::getInstance().addLocal(value, 1);
+		bound = detail::sumBound(bound, 1);
+		return *this;
+	}
+	NETINT_CONTROL_FLOW NetInt operator++(int) {
+		NetInt temp = *this;
+		value = detail::NetIntContext::getInstance().addLocal(value, 1);
+		bound = detail::sumBound(bound, 1);
+		return temp;
+	}
+	NETINT_CONTROL_FLOW NetInt &operator--() {
+		value = detail::NetIntContext::getInstance().subLocal(value, 1);
+		bound = detail::NO_BOUND;
+		return *this;
+	}
+	NETINT_CONTROL_FLOW NetInt operator--(int) {
+		NetInt temp = *this;
+		value = detail::NetIntContext::getInstance().subLocal(value, 1);
+		bound = detail::NO_BOUND;
+		return temp;
+	}
+	NetInt operator-() const {
+		return NetInt((detail::MOD - value) % detail::MOD, detail::NO_BOUND);
+	}
+	friend std::ostream &operator<<(std::ostream &os, const NetInt &netint) {
+		return os << netint.value;
+	}
+	friend std::istream &operator>>(std::istream &is, NetInt &netint) {
+		netint.bound = detail::NO_BOUND;
+		return is >> netint.value;
+	}
+
+	NETINT_CONTROL_FLOW operator int32_t() const { return value; }
+	int32_t getVal() const { return value; }
+};
+
+// Non-member arithmetic for int on the left
+template <typename T>
+NetInt operator+(const T &lhs, const NetInt &rhs) {
+	return NetInt(detail::NetIntContext::getInstance().addLocal(detail::operandValue(lhs), rhs.value), detail::sumBound(detail::operandBound(lhs), rhs.bound));
+}
+template <typename T>
+NetInt operator-(const T &lhs, const NetInt &rhs) {
+	return NetInt(detail::NetIntContext::getInstance().subLocal(detail::operandValue(lhs), rhs.value), detail::NO_BOUND);
+}
+template <typename T>
+NetInt operator*(const T &lhs, const NetInt &rhs) {
+	return NetInt(detail::NetIntContext::getInstance().scaleLocal(rhs.value, detail::operandValue(lhs)), detail::productBound(detail::operandBound(lhs), rhs.bound));
+}
+
+// Non-member comparisons for int on the left, evaluated with the public operand mirrored to the right
+template <typename T>
+bool operator<(const T &lhs, const NetInt &rhs) {
+	return detail::NetIntContext::getInstance().runGTPublic(rhs.value, detail::operandValue(lhs), detail::compareWidth(rhs.bound, detail::operandBound(lhs))) == 1;
+}
+template <typename T>
+bool operator<=(const T &lhs, const NetInt &rhs) {
+	return detail::NetIntContext::getInstance().runGEPublic(rhs.value, detail::operandValue(lhs), detail::compareWidth(rhs.bound, detail::operandBound(lhs))) == 1;
+}
+template <typename T>
+bool operator>(const T &lhs, const NetInt &rhs) {
+	return detail::NetIntContext::getInstance().runLTPublic(rhs.value, detail::operandValue(lhs), detail::compareWidth(rhs.bound, detail::operandBound(lhs))) == 1;
+}
+template <typename T>
+bool operator>=(const T &lhs, const NetInt &rhs) {
+	return detail::NetIntContext::getInstance().runLEPublic(rhs.value, detail::operandValue(lhs), detail::compareWidth(rhs.bound, detail::operandBound(lhs))) == 1;
+}
+template <typename T>
+bool operator==(const T &lhs, const NetInt &rhs) {
+	return detail::NetIntContext::getInstance().runEQPublic(rhs.value, detail::operandValue(lhs), detail::compareWidth(rhs.bound, detail::operandBound(lhs))) == 1;
+}
+template <typename T>
+bool operator!=(const T &lhs, const NetInt &rhs) {
+	return detail::NetIntContext::getInstance().runNEPublic(rhs.value, detail::operandValue(lhs), detail::compareWidth(rhs.bound, detail::operandBound(lhs))) == 1;
+}
+
+/*********************************************************************************
+ * @brief Public companion type for values that never need to be secret, such as loop
+ * indices, sizes, and bounds. Arithmetic and comparisons between PublicInt and plain
+ * ints are evaluated directly; mixing with a NetInt promotes the result to NetInt.
+ *********************************************************************************/
+struct PublicInt {
+	int32_t value;
+
+	PublicInt(int32_t val = 0) : value(val) {}
+
+	// Members take only public operands. PublicInt += NetInt would silently declassify the
+	// secret, so it does not compile; PublicInt + NetInt uses the free overloads below.
+	template <typename T, detail::IfPublic<T> = 0>
+	PublicInt operator+(const T &other) const {
+		return PublicInt(value + static_cast<int32_t>(other));
+	}
+	template <typename T, detail::IfPublic<T> = 0>
+	PublicInt operator-(const T &other) const {
+		return PublicInt(value - static_cast<int32_t>(other));
+	}
+	template <typename T, detail::IfPublic<T> = 0>
+	PublicInt operator*(const T &other) const {
+		return PublicInt(value * static_cast<int32_t>(other));
+	}
+	template <typename T, detail::IfPublic<T> = 0>
+	PublicInt &operator+=(const T &other) {
+		value += static_cast<int32_t>(other);
+		return *this;
+	}
+	template <typename T, detail::IfPublic<T> = 0>
+	PublicInt &operator-=(const T &other) {
+		value -= static_cast<int32_t>(other);
+		return *this;
+	}
+
+	template <typename T, detail::IfPublic<T> = 0>
+	bool operator<(const T &other) const { return value < static_cast<int32_t>(other); }
+	template <typename T, detail::IfPublic<T> = 0>
+	bool operator<=(const T &other) const { return value <= static_cast<int32_t>(other); }
+	template <typename T, detail::IfPublic<T> = 0>
+	bool operator>(const T &other) const { return value > static_cast<int32_t>(other); }
+	template <typename T, detail::IfPublic<T> = 0>
+	bool operator>=(const T &other) const { return value >= static_cast<int32_t>(other); }
+	template <typename T, detail::IfPublic<T> = 0>
+	bool operator==(const T &other) const { return value == static_cast<int32_t>(other); }
+	template <typename T, detail::IfPublic<T> = 0>
+	bool operator!=(const T &other) const { return value != static_cast<int32_t>(other); }
+
+	PublicInt &operator++() {
+		++value;
+		return *this;
+	}
+	PublicInt operator++(int) {
+		PublicInt temp = *this;
+		++value;
+		return temp;
+	}
+	PublicInt &operator--() {
+		--value;
+		return *this;
+	}
+	PublicInt operator--(int) {
+		PublicInt temp = *this;
+		--value;
+		return temp;
+	}
+	PublicInt operator-() const {
+		return PublicInt(-value);
+	}
+	friend std::ostream &operator<<(std::ostream &os, const PublicInt &pub) {
+		return os << pub.value;
+	}
+	friend std::istream &operator>>(std::istream &is, PublicInt &pub) {
+		return is >> pub.value;
+	}
+
+	operator int32_t() const { return value; }
+	int32_t getVal() const { return value; }
+};
+
+inline int32_t detail::operandValue(const NetInt &operand) {
+	return operand.value;
+}
+
+inline int32_t detail::operandBound(const NetInt &operand) {
+	return operand.bound;
+}
+
+inline NetInt::NetInt(const PublicInt &val) : value(val.value), bound(detail::constantBound(val.value)) {}
+
+inline NetInt &NetInt::operator=(const PublicInt &val) {
+	value = val.value;
+	bound = detail::constantBound(val.value);
+	return *this;
+}
+
+// Mixed PublicInt/NetInt expressions promote to NetInt
+inline NetInt operator+(const PublicInt &lhs, const NetInt &rhs) { return rhs + lhs.value; }
+inline NetInt operator-(const PublicInt &lhs, const NetInt &rhs) { return lhs.value - rhs; }
+inline NetInt operator*(const PublicInt &lhs, const NetInt &rhs) { return rhs * lhs.value; }
+inline bool operator<(const PublicInt &lhs, const NetInt &rhs) { return lhs.value < rhs; }
+inline bool operator<=(const PublicInt &lhs, const NetInt &rhs) { return lhs.value <= rhs; }
+inline bool operator>(const PublicInt &lhs, const NetInt &rhs) { return lhs.value > rhs; }
+inline bool operator>=(const PublicInt &lhs, const NetInt &rhs) { return lhs.value >= rhs; }
+inline bool operator==(const PublicInt &lhs, const NetInt &rhs) { return lhs.value == rhs; }
+inline bool operator!=(const PublicInt &lhs, const NetInt &rhs) { return lhs.value != rhs; }
+
+namespace detail {
+	/*********************************************************************************
+	 * @brief Unevaluated a*b + c*d + ... + e: P secret products plus a linear remainder.
+	 * NetInt * NetInt returns one of these instead of running the multiplication. Adding or
+	 * subtracting more products, secrets, or public values, and scaling by public values,
+	 * only combines terms at compile time. Converting to NetInt runs the whole expression as
+	 * one agent task: every share product and the sum of products is formed locally, then
+	 * renormalized once. A single unscaled product runs as a plain multiplication.
+	 * The result is cached, so `auto p = a * b;` runs on the agents once however often p is
+	 * used. Folding p into a larger expression builds a new one that runs p's products again.
+	 * @note Scaling and negation are folded into the left factors.
+	 *********************************************************************************/
+	template <size_t P>
+	struct ProductSum {
+		int32_t left[P], right[P];
+		int32_t leftBound[P], rightBound[P];
+		NetInt linear{0, 0};                 // Terms that need no multiplication
+		mutable std::optional<NetInt> result; // Set by the first evaluation
+
+		template <size_t Q>
+		ProductSum<P + Q> operator+(const ProductSum<Q> &other) const {
+			ProductSum<P + Q> sum;
+			for (size_t i = 0; i < P; i++) sum.setTerm(i, left[i], leftBound[i], right[i], rightBound[i]);
+			for (size_t i = 0; i < Q; i++) sum.setTerm(P + i, other.left[i], other.leftBound[i], other.right[i], other.rightBound[i]);
+			sum.linear = linear + other.linear;
+			return sum;
+		}
+		template <size_t Q>
+		ProductSum<P + Q> operator-(const ProductSum<Q> &other) const {
+			return *this + (-other);
+		}
+		ProductSum operator-() const {
+			ProductSum neg = *this;
+			for (size_t i = 0; i < P; i++) {
+				neg.left[i] = (MOD - left[i]) % MOD;
+				neg.leftBound[i] = NO_BOUND;
+			}
+			neg.linear = -linear;
+			neg.result.reset();
+			return neg;
+		}
+		ProductSum operator+(const NetInt &other) const {
+			ProductSum sum = *this;
+			sum.linear = linear + other;
+			sum.result.reset();
+			return sum;
+		}
+		ProductSum operator-(const NetInt &other) const {
+			ProductSum diff = *this;
+			diff.linear = linear - other;
+			diff.result.reset();
+			return diff;
+		}
+		template <typename T, IfPublic<T> = 0>
+		ProductSum operator+(const T &other) const {
+			ProductSum sum = *this;
+			sum.linear = linear + other;
+			sum.result.reset();
+			return sum;
+		}
+		template <typename T, IfPublic<T> = 0>
+		ProductSum operator-(const T &other) const {
+			ProductSum diff = *this;
+			diff.linear = linear - other;
+			diff.result.reset();
+			return diff;
+		}
+		template <typename T, IfPublic<T> = 0>
+		ProductSum operator*(const T &other) const {
+			ProductSum scaled = *this;
+			for (size_t i = 0; i < P; i++) {
+				scaled.left[i] = NetIntContext::getInstance().scaleLocal(left[i], operandValue(other));
+				scaled.leftBound[i] = productBound(leftBound[i], operandBound(other));
+			}
+			scaled.linear = linear * other;
+			scaled.result.reset();
+			return scaled;
+		}
+		ProductSum<1> operator*(const NetInt &other) const {
+			return evaluate() * other;
+		}
+		template <size_t Q>
+		ProductSum<1> operator*(const ProductSum<Q> &other) const {
+			return evaluate() * other.evaluate();
+		}
+
+		template <typename T>
+		bool operator<(const T &other) const { return evaluate() < other; }
+		template <typename T>
+		bool operator<=(const T &other) const { return evaluate() <= other; }
+		template <typename T>
+		bool operator>(const T &other) const { return evaluate() > other; }
+		template <typename T>
+		bool operator>=(const T &other) const { return evaluate() >= other; }
+		template <typename T>
+		bool operator==(const T &other) const { return evaluate() == other; }
+		template <typename T>
+		bool operator!=(const T &other) const { return evaluate() != other; }
+		bool operator<(const NetInt &other) const { return evaluate() < other; }
+		bool operator<=(const NetInt &other) const { return evaluate() <= other; }
+		bool operator>(const NetInt &other) const { return evaluate() > other; }
+		bool operator>=(const NetInt &other) const { return evaluate() >= other; }
+		bool operator==(const NetInt &other) const { return evaluate() == other; }
+		bool operator!=(const NetInt &other) const { return evaluate() != other; }
+
+		void setTerm(size_t i, int32_t a, int32_t aBound, int32_t b, int32_t bBound) {
+			left[i] = a;
+			leftBound[i] = aBound;
+			right[i] = b;
+			rightBound[i] = bBound;
+		}
+
+		/*********************************************************************************
+		 * @brief Run the expression, or return the cached result if it has already run.
+		 * @return NetInt: sum of all products and the linear terms
+		 *********************************************************************************/
+		NetInt evaluate() const {
+			if (result) return *result;
+			NetIntContext &ctx = NetIntContext::getInstance();
+			int32_t bound = linear.bound;
+			for (size_t i = 0; i < P; i++) bound = sumBound(bound, productBound(leftBound[i], rightBound[i]));
+			int32_t products;
+			if (P == 1) {
+				products = ctx.runMul(left[0], right[0]);
+			} else {
+				products = ctx.runBatchMatMul(std::vector<int32_t>(left, left + P), std::vector<int32_t>(right, right + P), 1, P, 1)[0];
+			}
+			result = NetInt(ctx.addLocal(products, linear.value), bound);
+			return *result;
+		}
+		operator NetInt() const { return evaluate(); }
+		int32_t getVal() const { return evaluate().value; }
+		friend std::ostream &operator<<(std::ostream &os, const ProductSum &sum) {
+			return os << sum.evaluate();
+		}
+	};
+}
+
+inline detail::ProductSum<1> NetInt::operator*(const NetInt &other) const {
+	detail::ProductSum<1> product;
+	product.setTerm(0, value, bound, other.value, other.bound);
+	return product;
+}
+
+template <size_t P>
+detail::ProductSum<1> NetInt::operator*(const detail::ProductSum<P> &other) const {
+	return *this * other.evaluate();
+}
+
+// Public values on the left of a product sum
+template <typename T, size_t P, typename std::enable_if<std::is_arithmetic<T>::value, int>::type = 0>
+detail::ProductSum<P> operator+(const T &lhs, const detail::ProductSum<P> &rhs) { return rhs + lhs; }
+template <typename T, size_t P, typename std::enable_if<std::is_arithmetic<T>::value, int>::type = 0>
+detail::ProductSum<P> operator-(const T &lhs, const detail::ProductSum<P> &rhs) { return -rhs + lhs; }
+template <typename T, size_t P, typename std::enable_if<std::is_arithmetic<T>::value, int>::type = 0>
+detail::ProductSum<P> operator*(const T &lhs, const detail::ProductSum<P> &rhs) { return rhs * lhs; }
+template <size_t P>
+detail::ProductSum<P> operator+(const PublicInt &lhs, const detail::ProductSum<P> &rhs) { return rhs + lhs; }
+template <size_t P>
+detail::ProductSum<P> operator-(const PublicInt &lhs, const detail::ProductSum<P> &rhs) { return -rhs + lhs; }
+template <size_t P>
+detail::ProductSum<P> operator*(const PublicInt &lhs, const detail::ProductSum<P> &rhs) { return rhs * lhs; }
+
+namespace detail {
+	/*********************************************************************************
+	 * @brief Largest known bound over an array.
+	 * @param const NetInt *values: array
+	 * @param size_t count: number of elements
+	 * @return int32_t: maximum bound, or NO_BOUND if any element is unbounded
+	 *********************************************************************************/
+	inline int32_t arrayBound(const NetInt *values, size_t count) {
+		int32_t top = 0;
+		for (size_t i = 0; i < count; i++) {
+			if (values[i].bound == NO_BOUND) return NO_BOUND;
+			top = std::max(top, values[i].bound);
+		}
+		return top;
+	}
+}
+
+/*********************************************************************************
+ * @brief Result of secureArgMin: the smallest value and the position it was found at.
+ *********************************************************************************/
+struct ArgMinResult {
+	NetInt min;
+	NetInt index;
+};
+
+/*********************************************************************************
+ * @brief Find the minimum of an array and its index with a tournament of batched comparisons.
+ * @param const NetInt *values: array to search
+ * @param size_t count: number of elements (must be at least 1)
+ * @return ArgMinResult: smallest value and the lowest index holding it
+ * @note Each tournament level compares every remaining pair in one batched comparison and
+ *       picks the winners with one batched multiplication, b * (right - left) + left, so
+ *       the comparison outcomes never drive control flow. That is ceil(log2(count)) levels.
+ *********************************************************************************/
+inline ArgMinResult secureArgMin(const NetInt *values, size_t count) {
+	if (count == 0) throw std::invalid_argument("secureArgMin needs at least one value");
+	detail::NetIntContext &ctx = detail::NetIntContext::getInstance();
+	int32_t bound = detail::arrayBound(values, count);
+	int width = detail::compareWidth(bound, bound);
+
+	std::vector<int32_t> mins(count), indices(count);
+	for (size_t i = 0; i < count; i++) {
+		mins[i] = values[i].value;
+		indices[i] = static_cast<int32_t>(i);
+	}
+
+	while (mins.size() > 1) {
+		size_t pairs = mins.size() / 2;
+		std::vector<int32_t> left(pairs), right(pairs);
+		for (size_t p = 0; p < pairs; p++) {
+			left[p] = mins[2 * p];
+			right[p] = mins[2 * p + 1];
+		}
+		// b = 1 when the right element is strictly smaller, so ties keep the lower index
+		std::vector<int32_t> takeRight = ctx.runBatchLT(right, left, width);
+
+		std::vector<int32_t> bits(2 * pairs), diffs(2 * pairs);
+		for (size_t p = 0; p < pairs; p++) {
+			bits[p] = bits[pairs + p] = takeRight[p];
+			diffs[p] = ctx.subLocal(mins[2 * p + 1], mins[2 * p]);
+			diffs[pairs + p] = ctx.subLocal(indices[2 * p + 1], indices[2 * p]);
+		}
+		std::vector<int32_t> offsets = ctx.runBatchMul(bits, diffs);
+
+		std::vector<int32_t> nextMins, nextIndices;
+		for (size_t p = 0; p < pairs; p++) {
+			nextMins.push_back(ctx.addLocal(mins[2 * p], offsets[p]));
+			nextIndices.push_back(ctx.addLocal(indices[2 * p], offsets[pairs + p]));
+		}
+		if (mins.size() % 2) {
+			nextMins.push_back(mins.back());
+			nextIndices.push_back(indices.back());
+		}
+		mins.swap(nextMins);
+		indices.swap(nextIndices);
+	}
+	return ArgMinResult{NetInt(mins[0], bound), NetInt(indices[0], static_cast<int32_t>(count - 1))};
+}
+
+inline ArgMinResult secureArgMin(const std::vector<NetInt> &values) {
+	return secureArgMin(values.data(), values.size());
+}
+
+namespace detail {
+	/*********************************************************************************
+	 * @brief Append the comparators of a bitonic merge of any length to a network.
+	 * @param size_t lo: first position
+	 * @param size_t n: number of positions
+	 * @param bool ascending: direction of the merge
+	 * @param std::vector<std::pair<size_t, size_t>> &net: comparators as (min slot, max slot)
+	 *********************************************************************************/
+	inline void bitonicMerge(size_t lo, size_t n, bool ascending, std::vector<std::pair<size_t, size_t>> &net) {
+		if (n < 2) return;
+		size_t m = 1;
+		while (m * 2 < n) m *= 2;
+		for (size_t i = lo; i < lo + n - m; i++) {
+			net.push_back(ascending ? std::make_pair(i, i + m) : std::make_pair(i + m, i));
+		}
+		bitonicMerge(lo, m, ascending, net);
+		bitonicMerge(lo + m, n - m, ascending, net);
+	}
+
+	/*********************************************************************************
+	 * @brief Append the comparators of a bitonic sort of any length to a network.
+	 * @param size_t lo: first position
+	 * @param size_t n: number of positions
+	 * @param bool ascending: direction of the sort
+	 * @param std::vector<std::pair<size_t, size_t>> &net: comparators as (min slot, max slot)
+	 *********************************************************************************/
+	inline void bitonicSort(size_t lo, size_t n, bool ascending, std::vector<std::pair<size_t, size_t>> &net) {
+		if (n < 2) return;
+		size_t m = n / 2;
+		bitonicSort(lo, m, !ascending, net);
+		bitonicSort(lo + m, n - m, ascending, net);
+		bitonicMerge(lo, n, ascending, net);
+	}
+
+	/*********************************************************************************
+	 * @brief Group the comparators of a network into layers of disjoint comparators.
+	 * @param const std::vector<std::pair<size_t, size_t>> &net: comparators in network order
+	 * @param size_t n: number of positions
+	 * @return std::vector<std::vector<std::pair<size_t, size_t>>>: comparators per layer
+	 *********************************************************************************/
+	inline std::vector<std::vector<std::pair<size_t, size_t>>> networkLayers(const std::vector<std::pair<size_t, size_t>> &net, size_t n) {
+		std::vector<size_t> depth(n, 0);
+		std::vector<std::vector<std::pair<size_t, size_t>>> layers;
+		for (const auto &c : net) {
+			size_t d = std::max(depth[c.first], depth[c.second]);
+			if (layers.size() <= d) layers.resize(d + 1);
+			layers[d].push_back(c);
+			depth[c.first] = depth[c.second] = d + 1;
+		}
+		return layers;
+	}
+}
+
+/*********************************************************************************
+ * @brief Sort an array in place, ascending, with a bitonic sorting network.
+ * @param NetInt *values: array to sort
+ * @param size_t count: number of elements
+ * @note The comparators depend only on count, never on the data. Each network layer sends
+ *       all of its compare-exchanges as one batched comparison plus one batched select,
+ *       for O(log^2 count) layers in total.
+ *********************************************************************************/
+inline void secureSort(NetInt *values, size_t count) {
+	detail::NetIntContext &ctx = detail::NetIntContext::getInstance();
+	int32_t bound = detail::arrayBound(values, count);
+	int width = detail::compareWidth(bound, bound);
+	std::vector<std::pair<size_t, size_t>> net;
+	detail::bitonicSort(0, count, true, net);
+
+	for (const auto &layer : detail::networkLayers(net, count)) {
+		std::vector<int32_t> lows(layer.size()), highs(layer.size()), diffs(layer.size());
+		for (size_t c = 0; c < layer.size(); c++) {
+			lows[c] = values[layer[c].first].value;
+			highs[c] = values[layer[c].second].value;
+		}
+		// b = 1 when the pair is out of order; the exchange moves b * (high - low) across
+		std::vector<int32_t> outOfOrder = ctx.runBatchLT(highs, lows, width);
+		for (size_t c = 0; c < layer.size(); c++) {
+			diffs[c] = ctx.subLocal(highs[c], lows[c]);
+		}
+		std::vector<int32_t> moved = ctx.runBatchMul(outOfOrder, diffs);
+		for (size_t c = 0; c < layer.size(); c++) {
+			values[layer[c].first] = NetInt(ctx.addLocal(lows[c], moved[c]), bound);
+			values[layer[c].second] = NetInt(ctx.subLocal(highs[c], moved[c]), bound);
+		}
+	}
+}
+
+inline void secureSort(std::vector<NetInt> &values) {
+	secureSort(values.data(), values.size());
+}
+
+/*********************************************************************************
+ * @brief Row-major matrix of NetInt values with public dimensions.
+ *********************************************************************************/
+struct NetIntMatrix {
+	size_t rows;
+	size_t cols;
+	std::vector<NetInt> data;
+
+	NetIntMatrix(size_t rows = 0, size_t cols = 0) : rows(rows), cols(cols), data(rows * cols) {}
+
+	NetInt &operator()(size_t row, size_t col) { return data[row * cols + col]; }
+	const NetInt &operator()(size_t row, size_t col) const { return data[row * cols + col]; }
+};
+
+/*********************************************************************************
+ * @brief Layout of a file of secret inputs.
+ * Text holds decimal integers separated by whitespace, commas, or semicolons, so CSV files
+ * without a header row work as they are. Binary holds little-endian 32-bit integers.
+ *********************************************************************************/
+enum class InputFormat {
+	Text,
+	Binary
+};
+
+/*********************************************************************************
+ * @brief Streaming reader that turns a file of plain integers into NetInt values.
+ * The file is read in fixed-size chunks, so memory use does not grow with its size, and
+ * values are parsed straight from the chunk without iostreams. Values are reduced into
+ * [0, MOD), with negative numbers wrapping the same way subtraction does. Every value gets
+ * the bound given to the constructor, so loading a column with a known range keeps its
+ * comparisons narrow. With a bound, each value must lie in [0, bound] as written in the file,
+ * before any reduction.
+ *********************************************************************************/
+class SecretInput {
+public:
+	/*********************************************************************************
+	 * @brief Open a file of secret inputs.
+	 * @param const std::string &path: file to read, or "-" for standard input
+	 * @param InputFormat format: Text or Binary
+	 * @param int32_t bound: largest value in the file, or NO_BOUND if unknown
+	 *********************************************************************************/
+	explicit SecretInput(const std::string &path, InputFormat format = InputFormat::Text, int32_t bound = detail::NO_BOUND)
+		: format(format), bound(bound), buffer(CHUNK) {
+		fd = (path == "-") ? STDIN_FILENO : open(path.c_str(), O_RDONLY);
+		if (fd < 0) throw std::runtime_error("Cannot open " + path + ": " + strerror(errno));
+	}
+	~SecretInput() {
+		if (fd > STDIN_FILENO) close(fd);
+	}
+	SecretInput(const SecretInput &) = delete;
+	SecretInput &operator=(const SecretInput &) = delete;
+
+	/*********************************************************************************
+	 * @brief Read the next values.
+	 * @param NetInt *out: destination
+	 * @param size_t max: most values to read
+	 * @return size_t: values read, 0 once the input is exhausted
+	 *********************************************************************************/
+	size_t read(NetInt *out, size_t max) {
+		return format == InputFormat::Text ? readText(out, max) : readBinary(out, max);
+	}
+
+	/*********************************************************************************
+	 * @brief Append every remaining value to a vector.
+	 *********************************************************************************/
+	void readAll(std::vector<NetInt> &out) {
+		const size_t step = 65536;
+		for (;;) {
+			size_t start = out.size();
+			out.resize(start + step);
+			size_t n = read(out.data() + start, step);
+			out.resize(start + n);
+			if (n == 0) break;
+		}
+	}
+
+	/*********************************************************************************
+	 * @brief Number of values on the first line of a text file, 0 until that line is read.
+	 *********************************************************************************/
+	size_t firstLineLength() const {
+		return firstLine;
+	}
+
+private:
+	static const size_t CHUNK = 1 << 20;
+	int fd;
+	InputFormat format;
+	int32_t bound;
+	std::vector<char> buffer;
+	size_t pos = 0, end = 0;
+	size_t line = 1, valuesRead = 0, firstLine = 0;
+	// Text parser state, kept across chunks so numbers may straddle them
+	// number is exact until overlong is set, residue is the number modulo MOD
+	bool inNumber = false, hasSign = false, overlong = false;
+	int64_t sign = 1, number = 0, residue = 0;
+
+	bool refill(size_t keep = 0) {
+		memmove(buffer.data(), buffer.data() + pos, keep);
+		pos = 0;
+		end = keep;
+		for (;;) {
+			ssize_t r = ::read(fd, buffer.data() + end, buffer.size() - end);
+			if (r > 0) {
+				end += r;
+				return true;
+			}
+			if (r == 0) return false;
+			if (errno != EINTR) throw std::runtime_error(std::string("Read failed: ") + strerror(errno));
+		}
+	}
+
+	NetInt make(int64_t v, int64_t residue) {
+		if (bound != detail::NO_BOUND && (v < 0 || v > bound)) {
+			throw std::invalid_argument("Input value " + std::to_string(v) + " is outside the declared bound [0, " + std::to_string(bound) + "]");
+		}
+		int32_t reduced = static_cast<int32_t>(residue % detail::MOD);
+		if (reduced < 0) reduced += detail::MOD;
+		valuesRead++;
+		return NetInt(reduced, bound);
+	}
+
+	NetInt make(int64_t v) {
+		return make(v, v);
+	}
+
+	NetInt makeText() {
+		inNumber = false;
+		if (overlong && bound != detail::NO_BOUND) {
+			throw std::invalid_argument("Line " + std::to_string(line) + ": input value is outside the declared bound [0, " + std::to_string(bound) + "]");
+		}
+		return make(sign * number, sign * residue);
+	}
+
+	size_t readText(NetInt *out, size_t max) {
+		size_t n = 0;
+		while (n < max) {
+			if (pos == end && !refill()) {
+				if (inNumber) {
+					out[n++] = makeText();
+				} else if (hasSign) {
+					throw std::runtime_error("Line " + std::to_string(line) + ": sign without a number");
+				}
+				break;
+			}
+			char c = buffer[pos++];
+			if (c >= '0' && c <= '9') {
+				if (!inNumber) {
+					inNumber = true;
+					overlong = false;
+					number = 0;
+					residue = 0;
+				}
+				int digit = c - '0';
+				residue = (residue * 10 + digit) % detail::MOD;
+				if (number > (INT64_MAX - digit) / 10) overlong = true;
+				if (!overlong) number = number * 10 + digit;
+				continue;
+			}
+			if (inNumber) {
+				out[n++] = makeText();
+			} else if (hasSign) {
+				throw std::runtime_error("Line " + std::to_string(line) + ": sign without a number");
+			}
+			sign = 1;
+			hasSign = false;
+			if (c == '-' || c == '+') {
+				sign = (c == '-') ? -1 : 1;
+				hasSign = true;
+			} else if (c == '\n') {
+				if (firstLine == 0) firstLine = valuesRead;
+				line++;
+			} else if (c != ' ' && c != '\t' && c != '\r' && c != ',' && c != ';') {
+				throw std::runtime_error("Line " + std::to_string(line) + ": unexpected character '" + std::string(1, c) + "'");
+			}
 		}
+		return n;
+	}
 
-	private:
-		void printMessage(const std::string &msg) const {
-			if (showMessages) {
-				std::cout << msg;
+	size_t readBinary(NetInt *out, size_t max) {
+		size_t n = 0;
+		while (n < max) {
+			if (end - pos < sizeof(int32_t) && !refill(end - pos)) {
+				if (end != pos) throw std::runtime_error("Binary input ends in the middle of a value");
+				break;
+			}
+			while (n < max && end - pos >= sizeof(int32_t)) {
+				const unsigned char *b = reinterpret_cast<const unsigned char *>(buffer.data() + pos);
+				int32_t v = static_cast<int32_t>(static_cast<uint32_t>(b[0]) | static_cast<uint32_t>(b[1]) << 8 | static_cast<uint32_t>(b[2]) << 16 | static_cast<uint32_t>(b[3]) << 24);
+				out[n++] = make(v);
+				pos += sizeof(int32_t);
 			}
 		}
-	};
+		return n;
+	}
+};
 
-	std::unique_ptr<NetIntContext> NetIntContext::instance;
+/*********************************************************************************
+ * @brief Load every value of a file of secret inputs.
+ * @param const std::string &path: file to read, or "-" for standard input
+ * @param InputFormat format: Text or Binary
+ * @param int32_t bound: largest value in the file, or NO_BOUND if unknown
+ * @return std::vector<NetInt>: the values in file order
+ *********************************************************************************/
+inline std::vector<NetInt> loadSecrets(const std::string &path, InputFormat format = InputFormat::Text, int32_t bound = detail::NO_BOUND) {
+	SecretInput input(path, format, bound);
+	std::vector<NetInt> values;
+	input.readAll(values);
+	return values;
 }
 
 /*********************************************************************************
- * @brief Public API for the NetInt library. Functions and structures beyond this point are intended to be interacted with.
- * This provides convenience functions to establish connections, disconnect agents,
- * and manage IP whitelists.
+ * @brief Load a matrix of secret inputs.
+ * @param const std::string &path: file to read, or "-" for standard input
+ * @param size_t cols: values per row, or 0 to take the length of the first line of a text file
+ * @param InputFormat format: Text or Binary
+ * @param int32_t bound: largest value in the file, or NO_BOUND if unknown
+ * @return NetIntMatrix: rows are consecutive runs of cols values
  *********************************************************************************/
-namespace detail {
-	class NetIntContext;
+inline NetIntMatrix loadSecretMatrix(const std::string &path, size_t cols = 0, InputFormat format = InputFormat::Text, int32_t bound = detail::NO_BOUND) {
+	SecretInput input(path, format, bound);
+	NetIntMatrix matrix;
+	std::vector<NetInt> &values = matrix.data;
+	input.readAll(values);
+	if (cols == 0) cols = input.firstLineLength() ? input.firstLineLength() : values.size();
+	if (cols == 0 || values.size() % cols != 0) {
+		throw std::runtime_error(path + ": " + std::to_string(values.size()) + " values do not fill rows of " + std::to_string(cols));
+	}
+	matrix.cols = cols;
+	matrix.rows = values.size() / cols;
+	return matrix;
 }
-void establishPort(const std::string &port);
-void disconnectAgents();
-void setWhitelist(const std::vector<std::string> &allowedIPs);
-void clearWhitelist();
-void hideMessages(bool hide = true);
 
-inline void establishPort(const std::string &port) {
-	detail::NetIntContext::getInstance().socket(port);
+/*********************************************************************************
+ * @brief Multiply two matrices with one batched task.
+ * @param const NetIntMatrix &a: left operand (n x k)
+ * @param const NetIntMatrix &b: right operand (k x m)
+ * @return NetIntMatrix: product (n x m)
+ * @note The agents compute every inner product locally and renormalize all n*m outputs in
+ *       one round, so the round count does not depend on the matrix size.
+ *********************************************************************************/
+inline NetIntMatrix secureMatMul(const NetIntMatrix &a, const NetIntMatrix &b) {
+	if (a.cols != b.rows) throw std::invalid_argument("secureMatMul: inner dimensions do not match");
+	std::vector<int32_t> av(a.data.size()), bv(b.data.size());
+	for (size_t i = 0; i < av.size(); i++) av[i] = a.data[i].value;
+	for (size_t i = 0; i < bv.size(); i++) bv[i] = b.data[i].value;
+
+	std::vector<int32_t> prod = detail::NetIntContext::getInstance().runBatchMatMul(av, bv, a.rows, a.cols, b.cols);
+	NetIntMatrix result(a.rows, b.cols);
+	for (size_t i = 0; i < prod.size(); i++) result.data[i] = NetInt(prod[i], detail::NO_BOUND);
+	return result;
 }
 
-inline void disconnectAgents() {
-	detail::NetIntContext::getInstance().disconnect();
+/*********************************************************************************
+ * @brief Inner product of two arrays with a single renormalization.
+ * @param const NetInt *a: first array
+ * @param const NetInt *b: second array
+ * @param size_t count: number of elements in each
+ * @return NetInt: sum of a[i] * b[i]
+ *********************************************************************************/
+inline NetInt secureDot(const NetInt *a, const NetInt *b, size_t count) {
+	std::vector<int32_t> av(count), bv(count);
+	for (size_t i = 0; i < count; i++) {
+		av[i] = a[i].value;
+		bv[i] = b[i].value;
+	}
+	return NetInt(detail::NetIntContext::getInstance().runBatchMatMul(av, bv, 1, count, 1)[0], detail::NO_BOUND);
 }
 
-inline void setWhitelist(const std::vector<std::string> &allowedIPs) {
-	detail::NetIntContext::getInstance().setIPWhitelist(allowedIPs);
+/*********************************************************************************
+ * @brief Sum an array without contacting the agents.
+ * @param const NetInt *values: array to sum
+ * @param size_t count: number of elements
+ * @return NetInt: sum of all elements mod MOD
+ * @note Addition of shares is linear, so the sum is folded locally like any other NetInt
+ *       addition and costs no round trips however long the array is.
+ *********************************************************************************/
+inline NetInt secureSum(const NetInt *values, size_t count) {
+	detail::NetIntContext &ctx = detail::NetIntContext::getInstance();
+	int32_t sum = 0, bound = 0;
+	for (size_t i = 0; i < count; i++) {
+		sum = ctx.addLocal(sum, values[i].value);
+		bound = detail::sumBound(bound, values[i].bound);
+	}
+	return NetInt(sum, bound);
 }
 
-inline void clearWhitelist() {
-	detail::NetIntContext::getInstance().clearIPWhitelist();
+inline NetInt secureSum(const std::vector<NetInt> &values) {
+	return secureSum(values.data(), values.size());
 }
 
-inline void hideMessages(bool hide) {
-	detail::NetIntContext::getInstance().hideMessages(hide);
+/*********************************************************************************
+ * @brief Mean of an array, rounded down, with a public divisor.
+ * @param const NetInt *values: array to average
+ * @param size_t count: number of elements
+ * @param int32_t divisor: public divisor, defaults to count
+ * @return NetInt: floor(sum / divisor)
+ * @note Exact while the sum stays below MOD, which a known bound on the elements guarantees.
+ *********************************************************************************/
+inline NetInt secureMean(const NetInt *values, size_t count, int32_t divisor = 0) {
+	if (divisor == 0) divisor = static_cast<int32_t>(count);
+	if (divisor <= 0) throw std::invalid_argument("secureMean needs a positive divisor");
+	NetInt sum = secureSum(values, count);
+	int32_t bound = (sum.bound == detail::NO_BOUND) ? detail::NO_BOUND : sum.bound / divisor;
+	return NetInt(sum.value / divisor, bound);
 }
 
-struct NetInt {
-	int32_t value;
-
-	NetInt(int32_t val = 0) : value(val) {}
-	NetInt(const NetInt &other) = default;
-	NetInt &operator=(const NetInt &other) = default;
-	NetInt &operator=(int32_t val) {
-		value = val;
-		return *this;
-	}
-
-	// Disable division, modulo, and bitwise operators
-	NetInt operator/(const NetInt &) const = delete;
-	NetInt operator/(int32_t) const = delete;
-	NetInt &operator/=(const NetInt &) = delete;
-	NetInt &operator/=(int32_t) = delete;
-
-	NetInt operator%(const NetInt &) const = delete;
-	NetInt operator%(int32_t) const = delete;
-	NetInt &operator%=(const NetInt &) = delete;
-	NetInt &operator%=(int32_t) = delete;
+inline NetInt secureMean(const std::vector<NetInt> &values, int32_t divisor = 0) {
+	return secureMean(values.data(), values.size(), divisor);
+}
 
-	NetInt operator&(const NetInt &other) const = delete;
-	NetInt operator|(const NetInt &other) const = delete;
-	NetInt operator^(const NetInt &other) const = delete;
-	NetInt operator~() const = delete;
+/*********************************************************************************
+ * @brief Comparison against a public constant, evaluated on every element by secureCount.
+ * Build one with Predicate::less(c), lessEqual, greater, greaterEqual, equal, or notEqual.
+ *********************************************************************************/
+struct Predicate {
+	enum Kind { Less, LessEqual, Greater, GreaterEqual, Equal, NotEqual };
+	Kind kind;
+	int32_t constant;
+
+	static Predicate less(int32_t c) { return {Less, c}; }
+	static Predicate lessEqual(int32_t c) { return {LessEqual, c}; }
+	static Predicate greater(int32_t c) { return {Greater, c}; }
+	static Predicate greaterEqual(int32_t c) { return {GreaterEqual, c}; }
+	static Predicate equal(int32_t c) { return {Equal, c}; }
+	static Predicate notEqual(int32_t c) { return {NotEqual, c}; }
+};
 
-	friend void swap(NetInt &a, NetInt &b) noexcept {
-		std::swap(a.value, b.value);
+/*********************************************************************************
+ * @brief Count the elements of an array that satisfy a predicate.
+ * @param const NetInt *values: array to test
+ * @param size_t count: number of elements
+ * @param const Predicate &predicate: comparison against a public constant
+ * @return NetInt: number of matching elements
+ * @note All comparisons run as one batched task and the agents sum the result bits on
+ *       their shares, so only the count is revealed, not which elements matched.
+ *********************************************************************************/
+inline NetInt secureCount(const NetInt *values, size_t count, const Predicate &predicate) {
+	detail::NetIntContext &ctx = detail::NetIntContext::getInstance();
+	int width = detail::compareWidth(detail::arrayBound(values, count), detail::constantBound(predicate.constant));
+	int32_t total = static_cast<int32_t>(count % detail::MOD);
+	int32_t c = predicate.constant;
+
+	// a <= c is a < c + 1, which is always true when c is the largest width-bit value
+	bool lessEqual = predicate.kind == Predicate::LessEqual || predicate.kind == Predicate::Greater;
+	bool saturated = false;
+	if (lessEqual) {
+		c &= (1 << width) - 1;
+		saturated = (c == (1 << width) - 1);
+		c++;
 	}
 
-	// Working Arithmetic operators
-	template <typename T>
-	NetInt operator+(const T &other) const {
-		return NetInt(detail::NetIntContext::getInstance().runAdd(value, static_cast<int32_t>(other)));
-	}
-	template <typename T>
-	NetInt operator-(const T &other) const {
-		return NetInt(detail::NetIntContext::getInstance().runSub(value, static_cast<int32_t>(other)));
+	std::vector<int32_t> a(count), constants(count, c);
+	for (size_t i = 0; i < count; i++) {
+		a[i] = values[i].value;
 	}
-	template <typename T>
-	NetInt operator*(const T &other) const {
-		return NetInt(detail::NetIntContext::getInstance().runMul(value, static_cast<int32_t>(other)));
+	int32_t matches;
+	switch (predicate.kind) {
+	case Predicate::Less:
+	case Predicate::GreaterEqual:
+	case Predicate::LessEqual:
+	case Predicate::Greater:
+		matches = saturated ? total : ctx.runCountLTPublic(a, constants, width);
+		if (predicate.kind == Predicate::GreaterEqual || predicate.kind == Predicate::Greater) {
+			matches = ctx.subLocal(total, matches);
+		}
+		break;
+	default:
+		matches = ctx.runCountEQPublic(a, constants, width);
+		if (predicate.kind == Predicate::NotEqual) {
+			matches = ctx.subLocal(total, matches);
+		}
+		break;
 	}
+	return NetInt(matches, detail::constantBound(total));
+}
 
-	// Compound assignment operators
-	template <typename T>
-	NetInt &operator+=(const T &other) {
-		value = detail::NetIntContext::getInstance().runAdd(value, static_cast<int32_t>(other));
-		return *this;
-	}
-	template <typename T>
-	NetInt &operator-=(const T &other) {
-		value = detail::NetIntContext::getInstance().runSub(value, static_cast<int32_t>(other));
-		return *this;
-	}
-	template <typename T>
-	NetInt &operator*=(const T &other) {
-		value = detail::NetIntContext::getInstance().runMul(value, static_cast<int32_t>(other));
-		return *this;
-	}
+inline NetInt secureCount(const std::vector<NetInt> &values, const Predicate &predicate) {
+	return secureCount(values.data(), values.size(), predicate);
+}
 
-	// Comparison operators
-	template <typename T>
-	bool operator<(const T &other) const {
-		return detail::NetIntContext::getInstance().runLT(value, static_cast<int32_t>(other)) == 1;
-	}
-	template <typename T>
-	bool operator<=(const T &other) const {
-		return detail::NetIntContext::getInstance().runLE(value, static_cast<int32_t>(other)) == 1;
-	}
-	template <typename T>
-	bool operator>(const T &other) const {
-		return detail::NetIntContext::getInstance().runGT(value, static_cast<int32_t>(other)) == 1;
-	}
-	template <typename T>
-	bool operator>=(const T &other) const {
-		return detail::NetIntContext::getInstance().runGE(value, static_cast<int32_t>(other)) == 1;
-	}
-	template <typename T>
-	bool operator==(const T &other) const {
-		return detail::NetIntContext::getInstance().runEQ(value, static_cast<int32_t>(other)) == 1;
+namespace detail {
+	/*********************************************************************************
+	 * @brief One-hot selectors for secret indices into a table of public size.
+	 * @param const std::vector<NetInt> &indices: k secret indices
+	 * @param size_t size: number of positions n
+	 * @return std::vector<int32_t>: k*n values, row i has a 1 at position indices[i]
+	 * @note Every index is compared against every position in one batched equality task.
+	 *       An index outside [0, n) selects nothing.
+	 *********************************************************************************/
+	inline std::vector<int32_t> selectors(const std::vector<NetInt> &indices, size_t size) {
+		if (indices.empty() || size == 0) return std::vector<int32_t>(indices.size() * size, 0);
+		int32_t bound = arrayBound(indices.data(), indices.size());
+		int width = compareWidth(bound, constantBound(static_cast<int32_t>(size - 1)));
+		std::vector<int32_t> a, positions;
+		a.reserve(indices.size() * size);
+		positions.reserve(indices.size() * size);
+		for (const NetInt &index : indices) {
+			for (size_t p = 0; p < size; p++) {
+				a.push_back(index.value);
+				positions.push_back(static_cast<int32_t>(p));
+			}
+		}
+		return NetIntContext::getInstance().runBatchEQPublic(a, positions, width);
 	}
-	template <typename T>
-	bool operator!=(const T &other) const {
-		return detail::NetIntContext::getInstance().runNE(value, static_cast<int32_t>(other)) == 1;
+}
+
+/*********************************************************************************
+ * @brief Array of secrets that can be read and written at secret indices.
+ * Plain indexing with an int or PublicInt works as usual. Indexing with a NetInt does not
+ * compile, because it would reveal the index. Use read and write for secret indices.
+ *
+ * An access compares the secret index against every position in one batched equality task.
+ * A read then takes the inner product of the one-hot result with the array, and a write
+ * blends the new value in with one batched multiplication. Passing several indices at
+ * once batches all their equality tests together.
+ *********************************************************************************/
+template <typename T = NetInt>
+struct SecretArray {
+	static_assert(std::is_same<T, NetInt>::value, "SecretArray elements must be NetInt");
+
+	std::vector<T> data;
+
+	SecretArray(size_t size = 0) : data(size) {}
+	SecretArray(const std::vector<T> &values) : data(values) {}
+
+	size_t size() const { return data.size(); }
+
+	T &operator[](size_t i) { return data[i]; }
+	const T &operator[](size_t i) const { return data[i]; }
+	T &operator[](const PublicInt &i) { return data[i.value]; }
+	const T &operator[](const PublicInt &i) const { return data[i.value]; }
+	T &operator[](const NetInt &) = delete;
+	const T &operator[](const NetInt &) const = delete;
+
+	/*********************************************************************************
+	 * @brief Read the element at a secret index.
+	 * @param const NetInt &index: position to read
+	 * @return T: the element, or 0 if index is out of range
+	 *********************************************************************************/
+	T read(const NetInt &index) const {
+		return read(std::vector<NetInt>{index})[0];
 	}
 
-	NetInt &operator++() {
-		value = detail::NetIntContext::getInstance().runAdd(value, 1);
-		return *this;
+	/*********************************************************************************
+	 * @brief Read the elements at several secret indices with one equality and one
+	 *        multiplication round for all of them.
+	 * @param const std::vector<NetInt> &indices: positions to read
+	 * @return std::vector<T>: the elements, in the order of indices
+	 *********************************************************************************/
+	std::vector<T> read(const std::vector<NetInt> &indices) const {
+		std::vector<T> result(indices.size());
+		if (indices.empty()) return result;
+		std::vector<int32_t> sel = detail::selectors(indices, data.size());
+		std::vector<int32_t> values(data.size());
+		for (size_t p = 0; p < data.size(); p++) {
+			values[p] = data[p].value;
+		}
+		std::vector<int32_t> picked = data.empty() ? std::vector<int32_t>(indices.size(), 0)
+		                                           : detail::NetIntContext::getInstance().runBatchMatMul(sel, values, indices.size(), data.size(), 1);
+		int32_t bound = data.empty() ? 0 : detail::arrayBound(data.data(), data.size());
+		for (size_t i = 0; i < indices.size(); i++) {
+			result[i] = NetInt(picked[i], bound);
+		}
+		return result;
 	}
-	NetInt operator++(int) {
-		NetInt temp = *this;
-		value = detail::NetIntContext::getInstance().runAdd(value, 1);
-		return temp;
+
+	/*********************************************************************************
+	 * @brief Write a value at a secret index. Every position is rewritten, so the
+	 *        index stays hidden.
+	 * @param const NetInt &index: position to write, nothing changes if out of range
+	 * @param const T &value: value to store
+	 *********************************************************************************/
+	void write(const NetInt &index, const T &value) {
+		write(std::vector<NetInt>{index}, std::vector<T>{value});
 	}
-	NetInt &operator--() {
-		value = detail::NetIntContext::getInstance().runSub(value, 1);
-		return *this;
+
+	/*********************************************************************************
+	 * @brief Write several values at secret indices, in order.
+	 * @param const std::vector<NetInt> &indices: positions to write
+	 * @param const std::vector<T> &values: values to store, one per index
+	 * @note The equality tests for all indices run as one batch. Each write then takes one
+	 *       multiplication round, so a later write to the same index wins.
+	 *********************************************************************************/
+	void write(const std::vector<NetInt> &indices, const std::vector<T> &values) {
+		if (indices.size() != values.size()) throw std::invalid_argument("SecretArray::write needs one value per index");
+		if (indices.empty() || data.empty()) return;
+		detail::NetIntContext &ctx = detail::NetIntContext::getInstance();
+		const size_t n = data.size();
+		std::vector<int32_t> sel = detail::selectors(indices, n);
+		int32_t bound = detail::arrayBound(data.data(), n);
+
+		for (size_t i = 0; i < indices.size(); i++) {
+			// data[p] += sel[p] * (value - data[p]) moves only the selected position
+			std::vector<int32_t> bits(sel.begin() + i * n, sel.begin() + (i + 1) * n), diffs(n);
+			for (size_t p = 0; p < n; p++) {
+				diffs[p] = ctx.subLocal(values[i].value, data[p].value);
+			}
+			std::vector<int32_t> offsets = ctx.runBatchMul(bits, diffs);
+			bound = (bound == detail::NO_BOUND || values[i].bound == detail::NO_BOUND) ? detail::NO_BOUND : std::max(bound, values[i].bound);
+			for (size_t p = 0; p < n; p++) {
+				data[p] = NetInt(ctx.addLocal(data[p].value, offsets[p]), bound);
+			}
+		}
 	}
-	NetInt operator--(int) {
-		NetInt temp = *this;
-		value = detail::NetIntContext::getInstance().runSub(value, 1);
-		return temp;
+};
+
+namespace detail {
+	template <typename A, typename = void>
+	struct IndexableByNetInt : std::false_type {};
+	template <typename A>
+	struct IndexableByNetInt<A, decltype(void(std::declval<A>()[std::declval<const NetInt &>()]))> : std::true_type {};
+}
+
+// Secret indexing must stay a compile error on both the mutable and the const overloads
+static_assert(!detail::IndexableByNetInt<SecretArray<> &>::value && !detail::IndexableByNetInt<const SecretArray<> &>::value,
+              "SecretArray must not be indexable by a NetInt");
+
+/*********************************************************************************
+ * @brief Read a whole row of a matrix at a secret row index.
+ * @param const NetIntMatrix &matrix: table to read from
+ * @param const NetInt &row: row to read, all zeros if out of range
+ * @return std::vector<NetInt>: the row
+ * @note One batched equality task over the rows, then every column's inner product with
+ *       the one-hot selector in a single multiplication round.
+ *********************************************************************************/
+inline std::vector<NetInt> secureRow(const NetIntMatrix &matrix, const NetInt &row) {
+	std::vector<NetInt> result(matrix.cols);
+	if (matrix.rows == 0 || matrix.cols == 0) return result;
+	std::vector<int32_t> sel = detail::selectors(std::vector<NetInt>{row}, matrix.rows);
+	std::vector<int32_t> values(matrix.data.size());
+	for (size_t i = 0; i < values.size(); i++) {
+		values[i] = matrix.data[i].value;
 	}
-	NetInt operator-() const {
-		return NetInt((detail::MOD - value) % detail::MOD);
+	std::vector<int32_t> picked = detail::NetIntContext::getInstance().runBatchMatMul(sel, values, 1, matrix.rows, matrix.cols);
+	int32_t bound = detail::arrayBound(matrix.data.data(), matrix.data.size());
+	for (size_t c = 0; c < matrix.cols; c++) {
+		result[c] = NetInt(picked[c], bound);
 	}
-	friend std::ostream &operator<<(std::ostream &os, const NetInt &netint) {
-		return os << netint.value;
+	return result;
+}
+
+namespace detail {
+	/*********************************************************************************
+	 * @brief Compare two arrays element by element and keep the results secret.
+	 * @param Predicate::Kind kind: comparison to apply, a[i] kind b[i]
+	 * @param const std::vector<NetInt> &a: left operands
+	 * @param const std::vector<NetInt> &b: right operands
+	 * @return std::vector<NetInt>: one secret bit per pair, bounded by 1
+	 *********************************************************************************/
+	inline std::vector<NetInt> compareBits(Predicate::Kind kind, const std::vector<NetInt> &a, const std::vector<NetInt> &b) {
+		if (a.size() != b.size()) throw std::invalid_argument("Secret comparisons need arrays of the same length");
+		NetIntContext &ctx = NetIntContext::getInstance();
+		int width = compareWidth(arrayBound(a.data(), a.size()), arrayBound(b.data(), b.size()));
+		std::vector<int32_t> av(a.size()), bv(b.size());
+		for (size_t i = 0; i < a.size(); i++) {
+			av[i] = a[i].value;
+			bv[i] = b[i].value;
+		}
+
+		// a <= b is not b < a, a > b is b < a, and a >= b is not a < b
+		std::vector<int32_t> bits;
+		bool negate = kind == Predicate::LessEqual || kind == Predicate::GreaterEqual || kind == Predicate::NotEqual;
+		if (kind == Predicate::Equal || kind == Predicate::NotEqual) {
+			bits = ctx.runBatchEQ(av, bv, width);
+		} else if (kind == Predicate::Less || kind == Predicate::GreaterEqual) {
+			bits = ctx.runBatchLT(av, bv, width);
+		} else {
+			bits = ctx.runBatchLT(bv, av, width);
+		}
+
+		std::vector<NetInt> result(bits.size());
+		for (size_t i = 0; i < bits.size(); i++) {
+			result[i] = NetInt(negate ? ctx.subLocal(1, bits[i]) : bits[i], 1);
+		}
+		return result;
 	}
-	friend std::istream &operator>>(std::istream &is, NetInt &netint) {
-		return is >> netint.value;
+
+	/*********************************************************************************
+	 * @brief Compare every element of an array against a public constant and keep the
+	 *        results secret.
+	 * @param const std::vector<NetInt> &a: secret operands
+	 * @param const Predicate &predicate: comparison against a public constant
+	 * @return std::vector<NetInt>: one secret bit per element, bounded by 1
+	 *********************************************************************************/
+	inline std::vector<NetInt> compareBits(const std::vector<NetInt> &a, const Predicate &predicate) {
+		NetIntContext &ctx = NetIntContext::getInstance();
+		int width = compareWidth(arrayBound(a.data(), a.size()), constantBound(predicate.constant));
+		Predicate::Kind kind = predicate.kind;
+		int32_t c = predicate.constant;
+		std::vector<int32_t> bits;
+
+		// a <= c is a < c + 1, which is always true when c is the largest width-bit value
+		if (kind == Predicate::LessEqual || kind == Predicate::Greater) {
+			c &= (1 << width) - 1;
+			if (c == (1 << width) - 1) bits.assign(a.size(), 1);
+			c++;
+		}
+		if (bits.empty() && !a.empty()) {
+			std::vector<int32_t> av(a.size()), constants(a.size(), c);
+			for (size_t i = 0; i < a.size(); i++) {
+				av[i] = a[i].value;
+			}
+			bool equality = kind == Predicate::Equal || kind == Predicate::NotEqual;
+			bits = equality ? ctx.runBatchEQPublic(av, constants, width) : ctx.runBatchLTPublic(av, constants, width);
+		}
+
+		bool negate = kind == Predicate::Greater || kind == Predicate::GreaterEqual || kind == Predicate::NotEqual;
+		std::vector<NetInt> result(bits.size());
+		for (size_t i = 0; i < bits.size(); i++) {
+			result[i] = NetInt(negate ? ctx.subLocal(1, bits[i]) : bits[i], 1);
+		}
+		return result;
 	}
+}
 
-	operator int32_t() const { return value; }
-	int32_t getVal() const { return value; }
-};
+/*********************************************************************************
+ * @brief Comparisons whose result stays a secret bit (a NetInt holding 0 or 1) instead of
+ * a bool, so it can feed secureSelect and further arithmetic without revealing anything.
+ * Each comes in a scalar form and a batched form that compares whole arrays in one task.
+ * The right operand may be a NetInt or a public value.
+ *********************************************************************************/
+inline NetInt secureLT(const NetInt &a, const NetInt &b) {
+	return detail::compareBits(Predicate::Less, {a}, {b})[0];
+}
+template <typename T>
+NetInt secureLT(const NetInt &a, const T &c) {
+	return detail::compareBits({a}, Predicate::less(detail::operandValue(c)))[0];
+}
+inline std::vector<NetInt> secureLT(const std::vector<NetInt> &a, const std::vector<NetInt> &b) {
+	return detail::compareBits(Predicate::Less, a, b);
+}
+template <typename T>
+std::vector<NetInt> secureLT(const std::vector<NetInt> &a, const T &c) {
+	return detail::compareBits(a, Predicate::less(detail::operandValue(c)));
+}
 
-// Non-member arithmetic for int on the left
+inline NetInt secureLE(const NetInt &a, const NetInt &b) {
+	return detail::compareBits(Predicate::LessEqual, {a}, {b})[0];
+}
 template <typename T>
-NetInt operator+(const T &lhs, const NetInt &rhs) {
-	return NetInt(detail::NetIntContext::getInstance().runAdd(static_cast<int32_t>(lhs), rhs.value));
+NetInt secureLE(const NetInt &a, const T &c) {
+	return detail::compareBits({a}, Predicate::lessEqual(detail::operandValue(c)))[0];
+}
+inline std::vector<NetInt> secureLE(const std::vector<NetInt> &a, const std::vector<NetInt> &b) {
+	return detail::compareBits(Predicate::LessEqual, a, b);
 }
 template <typename T>
-NetInt operator-(const T &lhs, const NetInt &rhs) {
-	return NetInt(detail::NetIntContext::getInstance().runSub(static_cast<int32_t>(lhs), rhs.value));
+std::vector<NetInt> secureLE(const std::vector<NetInt> &a, const T &c) {
+	return detail::compareBits(a, Predicate::lessEqual(detail::operandValue(c)));
+}
+
+inline NetInt secureGT(const NetInt &a, const NetInt &b) {
+	return detail::compareBits(Predicate::Greater, {a}, {b})[0];
 }
 template <typename T>
-NetInt operator*(const T &lhs, const NetInt &rhs) {
-	return NetInt(detail::NetIntContext::getInstance().runMul(static_cast<int32_t>(lhs), rhs.value));
+NetInt secureGT(const NetInt &a, const T &c) {
+	return detail::compareBits({a}, Predicate::greater(detail::operandValue(c)))[0];
+}
+inline std::vector<NetInt> secureGT(const std::vector<NetInt> &a, const std::vector<NetInt> &b) {
+	return detail::compareBits(Predicate::Greater, a, b);
+}
+template <typename T>
+std::vector<NetInt> secureGT(const std::vector<NetInt> &a, const T &c) {
+	return detail::compareBits(a, Predicate::greater(detail::operandValue(c)));
 }
 
-// Non-member comparisons for int on the left
+inline NetInt secureGE(const NetInt &a, const NetInt &b) {
+	return detail::compareBits(Predicate::GreaterEqual, {a}, {b})[0];
+}
 template <typename T>
-bool operator<(const T &lhs, const NetInt &rhs) {
-	return detail::NetIntContext::getInstance().runLT(static_cast<int32_t>(lhs), rhs.value) == 1;
+NetInt secureGE(const NetInt &a, const T &c) {
+	return detail::compareBits({a}, Predicate::greaterEqual(detail::operandValue(c)))[0];
+}
+inline std::vector<NetInt> secureGE(const std::vector<NetInt> &a, const std::vector<NetInt> &b) {
+	return detail::compareBits(Predicate::GreaterEqual, a, b);
 }
 template <typename T>
-bool operator<=(const T &lhs, const NetInt &rhs) {
-	return detail::NetIntContext::getInstance().runLE(static_cast<int32_t>(lhs), rhs.value) == 1;
+std::vector<NetInt> secureGE(const std::vector<NetInt> &a, const T &c) {
+	return detail::compareBits(a, Predicate::greaterEqual(detail::operandValue(c)));
+}
+
+inline NetInt secureEQ(const NetInt &a, const NetInt &b) {
+	return detail::compareBits(Predicate::Equal, {a}, {b})[0];
 }
 template <typename T>
-bool operator>(const T &lhs, const NetInt &rhs) {
-	return detail::NetIntContext::getInstance().runGT(static_cast<int32_t>(lhs), rhs.value) == 1;
+NetInt secureEQ(const NetInt &a, const T &c) {
+	return detail::compareBits({a}, Predicate::equal(detail::operandValue(c)))[0];
+}
+inline std::vector<NetInt> secureEQ(const std::vector<NetInt> &a, const std::vector<NetInt> &b) {
+	return detail::compareBits(Predicate::Equal, a, b);
 }
 template <typename T>
-bool operator>=(const T &lhs, const NetInt &rhs) {
-	return detail::NetIntContext::getInstance().runGE(static_cast<int32_t>(lhs), rhs.value) == 1;
+std::vector<NetInt> secureEQ(const std::vector<NetInt> &a, const T &c) {
+	return detail::compareBits(a, Predicate::equal(detail::operandValue(c)));
+}
+
+inline NetInt secureNE(const NetInt &a, const NetInt &b) {
+	return detail::compareBits(Predicate::NotEqual, {a}, {b})[0];
 }
 template <typename T>
-bool operator==(const T &lhs, const NetInt &rhs) {
-	return detail::NetIntContext::getInstance().runEQ(static_cast<int32_t>(lhs), rhs.value) == 1;
+NetInt secureNE(const NetInt &a, const T &c) {
+	return detail::compareBits({a}, Predicate::notEqual(detail::operandValue(c)))[0];
+}
+inline std::vector<NetInt> secureNE(const std::vector<NetInt> &a, const std::vector<NetInt> &b) {
+	return detail::compareBits(Predicate::NotEqual, a, b);
 }
 template <typename T>
-bool operator!=(const T &lhs, const NetInt &rhs) {
-	return detail::NetIntContext::getInstance().runNE(static_cast<int32_t>(lhs), rhs.value) == 1;
+std::vector<NetInt> secureNE(const std::vector<NetInt> &a, const T &c) {
+	return detail::compareBits(a, Predicate::notEqual(detail::operandValue(c)));
+}
+
+/*********************************************************************************
+ * @brief Pick between two values with a secret bit, without revealing which was picked.
+ * @param const std::vector<NetInt> &bits: secret bits, each 0 or 1
+ * @param const std::vector<NetInt> &a: values picked where the bit is 1
+ * @param const std::vector<NetInt> &b: values picked where the bit is 0
+ * @return std::vector<NetInt>: bits[i] ? a[i] : b[i]
+ * @note Computed as b + bit * (a - b), one batched multiplication round for all elements.
+ *********************************************************************************/
+inline std::vector<NetInt> secureSelect(const std::vector<NetInt> &bits, const std::vector<NetInt> &a, const std::vector<NetInt> &b) {
+	if (bits.size() != a.size() || a.size() != b.size()) throw std::invalid_argument("secureSelect needs arrays of the same length");
+	detail::NetIntContext &ctx = detail::NetIntContext::getInstance();
+	std::vector<int32_t> bv(bits.size()), diffs(bits.size());
+	for (size_t i = 0; i < bits.size(); i++) {
+		bv[i] = bits[i].value;
+		diffs[i] = ctx.subLocal(a[i].value, b[i].value);
+	}
+	std::vector<int32_t> offsets = bits.empty() ? std::vector<int32_t>() : ctx.runBatchMul(bv, diffs);
+	std::vector<NetInt> result(bits.size());
+	for (size_t i = 0; i < bits.size(); i++) {
+		int32_t bound = (a[i].bound == detail::NO_BOUND || b[i].bound == detail::NO_BOUND) ? detail::NO_BOUND : std::max(a[i].bound, b[i].bound);
+		result[i] = NetInt(ctx.addLocal(b[i].value, offsets[i]), bound);
+	}
+	return result;
+}
+
+inline NetInt secureSelect(const NetInt &bit, const NetInt &a, const NetInt &b) {
+	return secureSelect(std::vector<NetInt>{bit}, std::vector<NetInt>{a}, std::vector<NetInt>{b})[0];
+}
+
+/*********************************************************************************
+ * @brief Overwrite targets with new values where a secret bit is set. Every target is
+ *        rewritten either way, so the bits stay hidden.
+ * @param std::vector<NetInt> &targets: values to update
+ * @param const std::vector<NetInt> &bits: secret bits, each 0 or 1
+ * @param const std::vector<NetInt> &values: replacement values
+ * @note One batched multiplication round for all elements.
+ *********************************************************************************/
+inline void secureAssignIf(std::vector<NetInt> &targets, const std::vector<NetInt> &bits, const std::vector<NetInt> &values) {
+	targets = secureSelect(bits, values, targets);
+}
+
+inline void secureAssignIf(NetInt &target, const NetInt &bit, const NetInt &value) {
+	target = secureSelect(bit, value, target);
+}
+
+/*********************************************************************************
+ * @brief Distance secureShortestPaths reports for vertices it cannot reach.
+ * Path lengths must stay below it, and an unreachable distance plus any edge still fits
+ * below MOD, so relaxations never wrap around.
+ *********************************************************************************/
+const int32_t UNREACHABLE = (detail::MOD - 1) / 2;
+
+namespace detail {
+	/*********************************************************************************
+	 * @brief Secret bits marking which entries of an adjacency matrix are edges.
+	 *********************************************************************************/
+	inline std::vector<NetInt> edgeBits(const NetIntMatrix &adjacency) {
+		if (adjacency.rows != adjacency.cols) throw std::invalid_argument("Adjacency matrix must be square");
+		return secureNE(adjacency.data, 0);
+	}
+
+	/*********************************************************************************
+	 * @brief Deal a matrix to the agents once, for the rowTimes calls that follow.
+	 * @note The agents keep one matrix at a time, so this replaces the previous one.
+	 *********************************************************************************/
+	inline void keepMatrix(const NetIntMatrix &m) {
+		std::vector<int32_t> mv(m.data.size());
+		for (size_t i = 0; i < mv.size(); i++) {
+			mv[i] = m.data[i].value;
+		}
+		NetIntContext::getInstance().runKeepMatrix(mv, static_cast<uint32_t>(m.rows), static_cast<uint32_t>(m.cols));
+	}
+
+	/*********************************************************************************
+	 * @brief Multiply a row vector by the kept matrix in one round: out[c] = sum_r v[r] * m(r, c).
+	 * @note Only the V shares of v travel, not the matrix.
+	 *********************************************************************************/
+	inline std::vector<int32_t> rowTimes(const std::vector<int32_t> &v) {
+		return NetIntContext::getInstance().runBatchMatMulKept(v, 1);
+	}
+}
+
+/*********************************************************************************
+ * @brief Single-source shortest paths with Dijkstra's algorithm, without revealing the graph
+ *        or the order in which vertices are settled.
+ * @param const NetIntMatrix &adjacency: V x V non-negative edge weights up to UNREACHABLE,
+ *        0 means no edge
+ * @param size_t source: public source vertex
+ * @return std::vector<NetInt>: distance to every vertex, UNREACHABLE where there is no path
+ * @note Missing edges are replaced by UNREACHABLE once up front, and the agents keep the
+ *       resulting weights for the whole run. Each of the V - 1 iterations then picks the
+ *       closest unsettled vertex with secureArgMin over distances masked by the settled bits.
+ *       It reads that vertex's row through the argmin's one-hot selector in one round, which
+ *       sends only the V selector shares, and relaxes every neighbour at once with one
+ *       batched add, one batched comparison and one batched select. That is O(log V) rounds
+ *       and O(V) traffic per iteration.
+ *********************************************************************************/
+inline std::vector<NetInt> secureShortestPaths(const NetIntMatrix &adjacency, size_t source) {
+	const size_t n = adjacency.rows;
+	if (source >= n) throw std::invalid_argument("secureShortestPaths: source vertex out of range");
+	detail::NetIntContext &ctx = detail::NetIntContext::getInstance();
+	// Heavier edges would wrap relaxations around MOD. A declared bound settles it without
+	// looking at the weights, otherwise they are checked like SecretInput checks its input.
+	int32_t heaviest = detail::arrayBound(adjacency.data.data(), adjacency.data.size());
+	if (heaviest == detail::NO_BOUND) {
+		heaviest = 0;
+		for (const NetInt &w : adjacency.data) {
+			heaviest = std::max(heaviest, w.value);
+		}
+	}
+	if (heaviest > UNREACHABLE) {
+		throw std::invalid_argument("secureShortestPaths: edge weights must not exceed UNREACHABLE (" + std::to_string(UNREACHABLE) + ")");
+	}
+
+	NetIntMatrix weights(n, n);
+	weights.data = secureSelect(detail::edgeBits(adjacency), adjacency.data, std::vector<NetInt>(n * n, NetInt(UNREACHABLE, UNREACHABLE)));
+	detail::keepMatrix(weights);
+
+	std::vector<NetInt> dist(n, NetInt(UNREACHABLE, UNREACHABLE)), settled(n, NetInt(0, 1));
+	dist[source] = NetInt(0, UNREACHABLE);
+	const std::vector<NetInt> settledMask(n, NetInt(2 * UNREACHABLE, 2 * UNREACHABLE));
+
+	for (size_t iteration = 0; iteration + 1 < n; iteration++) {
+		// Settled vertices are masked above every unsettled distance, UNREACHABLE included
+		std::vector<NetInt> candidates = secureSelect(settled, settledMask, dist);
+		ArgMinResult closest = secureArgMin(candidates);
+		std::vector<int32_t> onehot = detail::selectors({closest.index}, n);
+		for (size_t v = 0; v < n; v++) {
+			settled[v] = NetInt(ctx.addLocal(settled[v].value, onehot[v]), 1);
+		}
+
+		std::vector<int32_t> row = detail::rowTimes(onehot);
+		std::vector<NetInt> through(n);
+		for (size_t v = 0; v < n; v++) {
+			through[v] = NetInt(ctx.addLocal(closest.min.value, row[v]), 2 * UNREACHABLE);
+		}
+		// Settled vertices are never shorter through a later vertex, so all are relaxed alike
+		secureAssignIf(dist, secureLT(through, dist), through);
+		for (size_t v = 0; v < n; v++) {
+			dist[v].setBound(UNREACHABLE);
+		}
+	}
+	return dist;
+}
+
+/*********************************************************************************
+ * @brief Vertices reachable from a source, found by breadth-first expansion without
+ *        revealing the graph.
+ * @param const NetIntMatrix &adjacency: V x V matrix, any nonzero entry is an edge
+ * @param size_t source: public source vertex
+ * @param size_t maxHops: number of expansion steps, defaults to V - 1 which reaches everything
+ * @return std::vector<NetInt>: secret bit per vertex, 1 if reachable within maxHops edges
+ * @note Every step runs the same two rounds whatever the graph looks like. It counts the
+ *       reached in-neighbours of every vertex with one row-times-matrix product against the
+ *       edge bits, which the agents keep for the whole run, then zero-tests the counts in
+ *       one batched comparison.
+ *********************************************************************************/
+inline std::vector<NetInt> secureReachable(const NetIntMatrix &adjacency, size_t source, size_t maxHops = SIZE_MAX) {
+	const size_t n = adjacency.rows;
+	if (source >= n) throw std::invalid_argument("secureReachable: source vertex out of range");
+	detail::NetIntContext &ctx = detail::NetIntContext::getInstance();
+	if (maxHops > n - 1) maxHops = n - 1;
+
+	NetIntMatrix edges(n, n);
+	edges.data = detail::edgeBits(adjacency);
+	detail::keepMatrix(edges);
+
+	std::vector<int32_t> reached(n, 0);
+	reached[source] = 1;
+	for (size_t hop = 0; hop < maxHops; hop++) {
+		std::vector<int32_t> incoming = detail::rowTimes(reached);
+		std::vector<NetInt> counts(n);
+		for (size_t v = 0; v < n; v++) {
+			counts[v] = NetInt(ctx.addLocal(reached[v], incoming[v]), static_cast<int32_t>(std::min<size_t>(n + 1, detail::MOD - 1)));
+		}
+		std::vector<NetInt> next = secureNE(counts, 0);
+		for (size_t v = 0; v < n; v++) {
+			reached[v] = next[v].value;
+		}
+	}
+
+	std::vector<NetInt> result(n);
+	for (size_t v = 0; v < n; v++) {
+		result[v] = NetInt(reached[v], 1);
+	}
+	return result;
 }
 
 #endif // NETINT_H
\ No newline at end of file
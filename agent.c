@@ -5,9 +5,22 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/random.h>
 #include <sys/socket.h>
+#include <sys/stat.h>
 #include <unistd.h>
 
+#include "dealer.h"
+#include "transcript.h"
+#ifdef NETINT_URING
+#include "uring.h"
+#endif
+
 // Protocol constants, structs, and macros
 #define JOIN_MSG "JOIN\n"
 #define NP 3
@@ -16,14 +29,26 @@
 #define GAMMA2 (MOD - 3)
 #define GAMMA3 1
 #define l 14
+#define DOT_TILE 64
+#define MESH_TIMEOUT_MS 5000 /* Longest wait for a peer before falling back to the server */
 
 enum {
 	OP_ADD = 0x01,
 	OP_MUL = 0x02,
 	OP_CMP = 0x03,
 	OP_EQL = 0x04,
+	OP_LT = 0x05,
+	OP_DOT = 0x06,
+	OP_LTC = 0x07,
+	OP_EQC = 0x08,
+	OP_STORE = 0x10,
+	OP_PRE = 0x20,
+	OP_BATCH = 0x40,
 	OP_REN = 0x80,
-	OP_RES = 0x81
+	OP_RES = 0x81,
+	OP_OPN = 0x82,
+	OP_MESH = 0x83,
+	OP_KEEP = 0x84
 };
 
 typedef struct __attribute__((packed)) {
@@ -39,8 +64,72 @@ typedef struct __attribute__((packed)) {
 	uint32_t value;
 } response_t;
 
+/* Header of a batched frame, followed by count 32-bit values in network byte order.
+   The high bit of width (WIDTH_SUM) asks for the outputs to be summed into one share.
+   WIDTH_PACKED means the values are packed at PACK_BITS each instead, and that every
+   frame of the task, including the mesh exchanges, is packed the same way. */
+#define WIDTH_SUM 0x80
+#define WIDTH_PACKED 0x40
+#define PACK_BITS 14 /* ceil(log2(MOD)) */
+typedef struct __attribute__((packed)) {
+	uint8_t op;
+	uint32_t count;
+	uint8_t width;
+} frame_t;
+
 int fd = -1;
 
+/* Preprocessed masks from netint-dealer, one mapped store per comparison width */
+typedef struct {
+	int fd;
+	pool_header_t *hdr;
+	size_t mapped;   /* Masks covered by the current mapping */
+	uint64_t cursor; /* Masks taken during a replay, which never touches the store's cursor */
+} pool_t;
+
+const char *poolDir = NULL;
+int agentIndex = 0;
+pool_t pools[l + 1];
+
+/* Direct connections to the other agents, indexed by party, once the server sets up the mesh */
+int listenFd = -1;
+int slot = 0;
+int peers[NP] = {-1, -1, -1};
+int meshActive = 0;
+
+/* Shares of a matrix the server dealt once with OP_KEEP, the right operand of OP_DOT | OP_STORE */
+int32_t *kept = NULL;
+uint32_t keptRows = 0, keptCols = 0;
+
+/*********************************************************************************
+ * @brief Scratch memory for one batched task.
+ * Every share array a task needs is bumped out of one 64-byte aligned block and released
+ * at once when the task's results are sent. A task that outgrows the block spills into
+ * separate allocations, and the next reset replaces the block with one large enough for
+ * both, so after the first large batch the hot path runs without touching the heap.
+ *********************************************************************************/
+#define ARENA_ALIGN 64
+#define ARENA_MIN ((size_t)1 << 20)
+
+typedef struct {
+	char *base;
+	size_t used, size;
+	void **spill; /* Overflow blocks of the current task */
+	size_t spillCount, spillBytes;
+} arena_t;
+
+arena_t arena = {NULL, 0, 0, NULL, 0, 0};
+
+/* Frames recorded with -r, or replayed from a transcript with -R instead of the network */
+transcript_writer_t recording = {NULL, 0};
+transcript_reader_t replay;
+int replaying = 0;
+
+/* Reused buffer for outgoing frames */
+char *frameBuf = NULL;
+size_t frameCap = 0;
+int packedTask = 0; /* The current task's frames carry packed values */
+
 /*********************************************************************************
  * @brief Look up the host and connect to the specified service.
  * @param const char *host: hostname or IP address
@@ -85,21 +174,77 @@ int lookup_and_connect(const char *host, const char *service) {
 	return s;
 }
 
+/*********************************************************************************
+ * @brief Transcript connection of a socket: 0 for the server, 1..3 for mesh peers.
+ * @return int: connection, or -1 for sockets that are not recorded
+ *********************************************************************************/
+static int connOf(int s) {
+	if (s == fd) return 0;
+	for (int k = 0; k < NP; k++) {
+		if (peers[k] == s) return k + 1;
+	}
+	return -1;
+}
+
 /*********************************************************************************
  * @brief Receive all bytes from a socket until the specified length is reached.
- * @param int fd: file descriptor of the socket
+ * @param int s: file descriptor of the socket
  * @param void *buf: buffer to store received data
  * @param size_t len: number of bytes to receive
  * @return ssize_t: number of bytes received, or -1 on error
+ * @note When replaying, the bytes come from the transcript instead.
  *********************************************************************************/
-static ssize_t recvAll(int fd, void *buf, size_t len) {
-	size_t got = 0;
-	while (got < len) {
-		ssize_t r = recv(fd, (char *)buf + got, len - got, 0);
+static ssize_t recvAll(int s, void *buf, size_t len) {
+	if (replaying) {
+		int conn = connOf(s);
+		return conn < 0 ? -1 : (ssize_t)transcriptRead(&replay, conn, buf, len);
+	}
+	ssize_t got = 0;
+#ifdef NETINT_URING
+	int conn = netringConn(s);
+	if (conn >= 0) got = netringRecv(conn, buf, len);
+	else
+#endif
+	while ((size_t)got < len) {
+		ssize_t r = recv(s, (char *)buf + got, len - (size_t)got, 0);
 		if (r <= 0) return r;
-		got += (size_t)r;
+		got += r;
 	}
-	return (ssize_t)got;
+	if (got > 0) transcriptRecord(&recording, TRANSCRIPT_RECEIVED, connOf(s), buf, (size_t)got);
+	return got;
+}
+
+/*********************************************************************************
+ * @brief Send a buffer on a socket.
+ * @return ssize_t: number of bytes sent, or -1 on error
+ * @note With io_uring the bytes are queued and go out with the next receive, which
+ *       submits them and waits for the answer in one system call. When replaying they
+ *       are dropped.
+ *********************************************************************************/
+static ssize_t sendAll(int s, const void *buf, size_t len) {
+	if (replaying) return (ssize_t)len;
+	ssize_t sent;
+#ifdef NETINT_URING
+	int conn = netringConn(s);
+	if (conn >= 0) {
+		netringSend(conn, buf, len);
+		sent = (ssize_t)len;
+	} else
+#endif
+	sent = send(s, buf, len, 0);
+	if (sent > 0) transcriptRecord(&recording, TRANSCRIPT_SENT, connOf(s), buf, (size_t)sent);
+	return sent;
+}
+
+/*********************************************************************************
+ * @brief Whether sends to a socket are queued rather than written, so they never block.
+ *********************************************************************************/
+static int sendsQueued(int s) {
+#ifdef NETINT_URING
+	if (netringConn(s) >= 0) return 1;
+#endif
+	(void)s;
+	return replaying;
 }
 
 /*********************************************************************************
@@ -110,7 +255,7 @@ static ssize_t recvAll(int fd, void *buf, size_t len) {
  *********************************************************************************/
 int32_t runRENORM(int32_t value) {
 	response_t r = {OP_REN, htonl((uint32_t)value)};
-	if (send(fd, &r, sizeof r, 0) != sizeof r) {
+	if (sendAll(fd, &r, sizeof r) != sizeof r) {
 		perror("send");
 	}
 	if (recvAll(fd, &r, sizeof r) != sizeof r) {
@@ -128,32 +273,1184 @@ int32_t runRENORM(int32_t value) {
 }
 
 /*********************************************************************************
- * @brief Main function for the agent that connects to the server and processes tasks.
- * @param int argc: number of command line arguments
- * @param char **argv: command line arguments
- * @return int: exit status
+ * @brief Allocate scratch memory from the task arena, exiting on failure.
+ * @param size_t bytes: number of bytes
+ * @return void *: 64-byte aligned memory, valid until arenaReset
  *********************************************************************************/
-int main(int argc, char **argv) {
-	if (argc != 3) {
-		fprintf(stderr, "usage: %s <server-ip> <port>\n", argv[0]);
+static void *arenaAlloc(size_t bytes) {
+	bytes = bytes ? (bytes + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1) : ARENA_ALIGN;
+	if (arena.used + bytes <= arena.size) {
+		void *p = arena.base + arena.used;
+		arena.used += bytes;
+		return p;
+	}
+	void **spill = realloc(arena.spill, (arena.spillCount + 1) * sizeof *spill);
+	void *p = aligned_alloc(ARENA_ALIGN, bytes);
+	if (!spill || !p) {
+		perror("malloc");
+		exit(EXIT_FAILURE);
+	}
+	arena.spill = spill;
+	arena.spill[arena.spillCount++] = p;
+	arena.spillBytes += bytes;
+	return p;
+}
+
+/*********************************************************************************
+ * @brief Release everything allocated since the last reset.
+ * @note If the task spilled, the block is regrown to hold the whole task next time.
+ *********************************************************************************/
+static void arenaReset(void) {
+	if (arena.spillCount) {
+		size_t size = arena.size ? arena.size : ARENA_MIN;
+		while (size < arena.used + arena.spillBytes) size *= 2;
+		for (size_t i = 0; i < arena.spillCount; i++) {
+			free(arena.spill[i]);
+		}
+		free(arena.base);
+		arena.base = aligned_alloc(ARENA_ALIGN, size);
+		if (!arena.base) {
+			perror("malloc");
+			exit(EXIT_FAILURE);
+		}
+		arena.size = size;
+		arena.spillCount = 0;
+		arena.spillBytes = 0;
+	}
+	arena.used = 0;
+}
+
+/*********************************************************************************
+ * @brief Allocate a scratch array of share values from the task arena.
+ * @param size_t count: number of values
+ * @return int32_t *: aligned array, released with the arena
+ *********************************************************************************/
+static int32_t *allocShares(size_t count) {
+	return (int32_t *)arenaAlloc(count * sizeof(int32_t));
+}
+
+/*********************************************************************************
+ * @brief Bytes taken by count packed values.
+ *********************************************************************************/
+static size_t packedSize(uint32_t count) {
+	return ((size_t)count * PACK_BITS + 7) / 8;
+}
+
+/*********************************************************************************
+ * @brief Pack values below 2^PACK_BITS, least significant bits first.
+ * @param const int32_t *values: values to pack
+ * @param uint32_t count: number of values
+ * @param uint8_t *out: packedSize(count) bytes
+ * @note Four values fill exactly seven bytes, so each group is assembled in one 64-bit
+ *       word and written out byte by byte. This is plain scalar code.
+ *********************************************************************************/
+static void packValues(const int32_t *values, uint32_t count, uint8_t *out) {
+	uint32_t i = 0;
+	for (; i + 4 <= count; i += 4, out += 7) {
+		uint64_t word = (uint64_t)values[i] | (uint64_t)values[i + 1] << 14 | (uint64_t)values[i + 2] << 28 | (uint64_t)values[i + 3] << 42;
+		for (int b = 0; b < 7; b++) {
+			out[b] = (uint8_t)(word >> (8 * b));
+		}
+	}
+	uint64_t word = 0;
+	for (uint32_t k = 0; i + k < count; k++) {
+		word |= (uint64_t)values[i + k] << (PACK_BITS * k);
+	}
+	for (size_t b = 0; b < packedSize(count - i); b++) {
+		out[b] = (uint8_t)(word >> (8 * b));
+	}
+}
+
+/*********************************************************************************
+ * @brief Unpack values written by packValues.
+ * @param const uint8_t *in: packedSize(count) bytes
+ * @param uint32_t count: number of values
+ * @param int32_t *values: destination
+ *********************************************************************************/
+static void unpackValues(const uint8_t *in, uint32_t count, int32_t *values) {
+	const uint64_t mask = (1u << PACK_BITS) - 1;
+	uint32_t i = 0;
+	for (; i + 4 <= count; i += 4, in += 7) {
+		uint64_t word = 0;
+		for (int b = 0; b < 7; b++) {
+			word |= (uint64_t)in[b] << (8 * b);
+		}
+		values[i] = (int32_t)(word & mask);
+		values[i + 1] = (int32_t)(word >> 14 & mask);
+		values[i + 2] = (int32_t)(word >> 28 & mask);
+		values[i + 3] = (int32_t)(word >> 42 & mask);
+	}
+	uint64_t word = 0;
+	for (size_t b = 0; b < packedSize(count - i); b++) {
+		word |= (uint64_t)in[b] << (8 * b);
+	}
+	for (uint32_t k = 0; i + k < count; k++) {
+		values[i + k] = (int32_t)(word >> (PACK_BITS * k) & mask);
+	}
+}
+
+/*********************************************************************************
+ * @brief Send a batched frame to the server.
+ * @param uint8_t op: opcode including OP_BATCH
+ * @param uint8_t width: bit width carried in the header
+ * @param const int32_t *values: payload values in host byte order
+ * @param uint32_t count: number of payload values
+ *********************************************************************************/
+static void sendFrame(uint8_t op, uint8_t width, const int32_t *values, uint32_t count) {
+	size_t len = sizeof(frame_t) + ((width & WIDTH_PACKED) ? packedSize(count) : (size_t)count * sizeof(uint32_t));
+	if (len > frameCap) {
+		free(frameBuf);
+		frameCap = len > 4096 ? len : 4096;
+		frameBuf = malloc(frameCap);
+		if (!frameBuf) {
+			perror("malloc");
+			exit(EXIT_FAILURE);
+		}
+	}
+	char *buf = frameBuf;
+	frame_t hdr = {op, htonl(count), width};
+	memcpy(buf, &hdr, sizeof hdr);
+	if (width & WIDTH_PACKED) {
+		packValues(values, count, (uint8_t *)buf + sizeof hdr);
+	} else {
+		for (uint32_t i = 0; i < count; i++) {
+			uint32_t v = htonl((uint32_t)values[i]);
+			memcpy(buf + sizeof hdr + i * sizeof v, &v, sizeof v);
+		}
+	}
+	if (sendAll(fd, buf, len) != (ssize_t)len) {
+		perror("send");
+		exit(EXIT_FAILURE);
+	}
+}
+
+/*********************************************************************************
+ * @brief Receive count values from the server straight into a caller's array.
+ * @param int32_t *values: destination, in host byte order on return
+ * @param uint32_t count: number of values
+ * @param int packed: whether the frame's width carried WIDTH_PACKED
+ *********************************************************************************/
+static void recvValues(int32_t *values, uint32_t count, int packed) {
+	size_t len = packed ? packedSize(count) : (size_t)count * sizeof(int32_t);
+	void *wire = packed ? arenaAlloc(len) : (void *)values;
+	if (len && recvAll(fd, wire, len) != (ssize_t)len) {
+		fprintf(stderr, "Server left\n");
+		close(fd);
+		exit(EXIT_FAILURE);
+	}
+	if (packed) {
+		unpackValues(wire, count, values);
+		return;
+	}
+	for (uint32_t i = 0; i < count; i++) {
+		values[i] = (int32_t)ntohl((uint32_t)values[i]);
+	}
+}
+
+/*********************************************************************************
+ * @brief Receive the payload of a batched frame whose header has been read.
+ * @param frame_t *hdr: header, count is converted to host byte order in place
+ * @return int32_t *: payload in host byte order, allocated from the task arena
+ *********************************************************************************/
+static int32_t *recvPayload(frame_t *hdr) {
+	hdr->count = ntohl(hdr->count);
+	int32_t *values = allocShares(hdr->count);
+	recvValues(values, hdr->count, (hdr->width & WIDTH_PACKED) != 0);
+	return values;
+}
+
+/*********************************************************************************
+ * @brief Uniform value in [0, MOD) from the kernel's random source.
+ *********************************************************************************/
+static int32_t randMod(void) {
+	static uint32_t buf[1024];
+	static size_t left = 0;
+	const uint32_t limit = UINT32_MAX - UINT32_MAX % MOD;
+	for (;;) {
+		if (left == 0) {
+			if (getrandom(buf, sizeof buf, 0) != (ssize_t)sizeof buf) {
+				perror("getrandom");
+				exit(EXIT_FAILURE);
+			}
+			left = sizeof buf / sizeof buf[0];
+		}
+		uint32_t r = buf[--left];
+		if (r < limit) return (int32_t)(r % MOD);
+	}
+}
+
+/*********************************************************************************
+ * @brief Open the listening socket other agents connect to, on an ephemeral port.
+ * @return int: port number, or -1 if no socket could be opened
+ *********************************************************************************/
+static int openMeshListener(void) {
+	struct sockaddr_in addr;
+	socklen_t len = sizeof addr;
+	memset(&addr, 0, sizeof addr);
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_ANY);
+	listenFd = socket(AF_INET, SOCK_STREAM, 0);
+	if (listenFd < 0) return -1;
+	if (bind(listenFd, (struct sockaddr *)&addr, sizeof addr) != 0 || listen(listenFd, NP) != 0 ||
+	    getsockname(listenFd, (struct sockaddr *)&addr, &len) != 0) {
+		close(listenFd);
+		listenFd = -1;
+		return -1;
+	}
+	return ntohs(addr.sin_port);
+}
+
+/*********************************************************************************
+ * @brief Connect to a peer's mesh listener, giving up after MESH_TIMEOUT_MS.
+ * @param const struct sockaddr_in *addr: peer address and mesh port
+ * @return int: connected blocking socket, or -1 on error or timeout
+ * @note The connect runs non-blocking so an unreachable peer, whose SYNs are dropped
+ *       rather than refused, cannot stall the agent for the kernel's connect timeout.
+ *********************************************************************************/
+static int connectPeer(const struct sockaddr_in *addr) {
+	int s = socket(AF_INET, SOCK_STREAM, 0);
+	if (s < 0) return -1;
+	int flags = fcntl(s, F_GETFL, 0);
+	if (flags < 0 || fcntl(s, F_SETFL, flags | O_NONBLOCK) != 0) {
+		close(s);
+		return -1;
+	}
+	if (connect(s, (const struct sockaddr *)addr, sizeof *addr) != 0) {
+		struct pollfd pfd = {s, POLLOUT, 0};
+		int err = 0;
+		socklen_t len = sizeof err;
+		if (errno != EINPROGRESS) {
+			close(s);
+			return -1;
+		}
+		int ready;
+		do {
+			ready = poll(&pfd, 1, MESH_TIMEOUT_MS);
+		} while (ready < 0 && errno == EINTR);
+		if (ready == 0) errno = ETIMEDOUT;
+		if (ready != 1 || getsockopt(s, SOL_SOCKET, SO_ERROR, &err, &len) != 0 || err != 0) {
+			if (err != 0) errno = err;
+			close(s);
+			return -1;
+		}
+	}
+	if (fcntl(s, F_SETFL, flags) != 0) {
+		close(s);
+		return -1;
+	}
+	return s;
+}
+
+/*********************************************************************************
+ * @brief Connect to the other agents as announced by the server.
+ * @param const int32_t *vals: own party index, then address and port of each party
+ * @param uint32_t count: number of values, 1 + 2 * NP
+ * @return int: 1 if every peer is connected, 0 otherwise
+ * @note Each agent dials the parties below it and accepts the ones above it, which only
+ *       works because every agent listens before it joins. An accepted peer must come from
+ *       the address the server announced for the index it claims.
+ *********************************************************************************/
+static int setupMesh(const int32_t *vals, uint32_t count) {
+	if (count != 1 + 2 * NP || vals[0] < 1 || vals[0] > NP) return 0;
+	slot = vals[0];
+	if (replaying) {
+		// Peers exist only as connections in the transcript
+		for (int k = 0; k < NP; k++) {
+			if (k != slot - 1) peers[k] = -3 - k;
+		}
 		return 1;
 	}
+	if (listenFd < 0) return 0;
+	int one = 1;
+	for (int k = 0; k < slot - 1; k++) {
+		struct sockaddr_in addr;
+		memset(&addr, 0, sizeof addr);
+		addr.sin_family = AF_INET;
+		addr.sin_addr.s_addr = htonl((uint32_t)vals[1 + 2 * k]);
+		addr.sin_port = htons((uint16_t)vals[2 + 2 * k]);
+		int s = connectPeer(&addr);
+		if (s < 0) {
+			perror("mesh connect");
+			return 0;
+		}
+		uint8_t me = (uint8_t)slot;
+		if (send(s, &me, 1, 0) != 1) {
+			close(s);
+			return 0;
+		}
+		setsockopt(s, IPPROTO_TCP, TCP_NODELAY, &one, sizeof one);
+		peers[k] = s;
+	}
+	for (int accepted = slot; accepted < NP; accepted++) {
+		struct pollfd pfd = {listenFd, POLLIN, 0};
+		if (poll(&pfd, 1, MESH_TIMEOUT_MS) != 1) {
+			fprintf(stderr, "Timed out waiting for the other agents\n");
+			return 0;
+		}
+		struct sockaddr_in addr;
+		socklen_t len = sizeof addr;
+		int s = accept(listenFd, (struct sockaddr *)&addr, &len);
+		uint8_t index = 0;
+		if (s < 0 || recvAll(s, &index, 1) != 1 || index <= slot || index > NP || peers[index - 1] != -1 ||
+		    addr.sin_addr.s_addr != htonl((uint32_t)vals[1 + 2 * (index - 1)])) {
+			fprintf(stderr, "Rejected an unexpected mesh connection\n");
+			if (s >= 0) close(s);
+			accepted--;
+			continue;
+		}
+		setsockopt(s, IPPROTO_TCP, TCP_NODELAY, &one, sizeof one);
+		peers[index - 1] = s;
+	}
+#ifdef NETINT_URING
+	for (int k = 0; k < NP; k++) {
+		if (peers[k] >= 0 && netringConn(fd) >= 0) netringAdd(k + 1, peers[k]);
+	}
+#endif
+	return 1;
+}
 
-	fd = lookup_and_connect(argv[1], argv[2]);
-	if (fd < 0) return 1;
+/*********************************************************************************
+ * @brief Send a block of values to each peer and receive one from each, concurrently.
+ * @param const int32_t *out[NP]: values for each peer, in host byte order
+ * @param int32_t *in[NP]: buffers for the values each peer sends
+ * @param uint32_t count: values per peer
+ * @note Plain sockets interleave sends and receives with poll, so large blocks cannot
+ *       deadlock with every agent stuck sending into a full socket buffer.
+ *********************************************************************************/
+static void exchangeWithPeers(const int32_t *out[NP], int32_t *in[NP], uint32_t count) {
+	const size_t len = packedTask ? packedSize(count) : (size_t)count * sizeof(int32_t);
+	char *wire[NP] = {NULL}, *rx[NP] = {NULL};
+	size_t sent[NP] = {0}, got[NP] = {0};
+	for (int k = 0; k < NP; k++) {
+		if (k == slot - 1) continue;
+		wire[k] = (char *)allocShares(count);
+		rx[k] = packedTask ? arenaAlloc(len) : (char *)in[k];
+		if (packedTask) {
+			packValues(out[k], count, (uint8_t *)wire[k]);
+			continue;
+		}
+		uint32_t *w = (uint32_t *)wire[k];
+		for (uint32_t v = 0; v < count; v++) {
+			w[v] = htonl((uint32_t)out[k][v]);
+		}
+	}
+	// Queued sends (io_uring, or a replay) cannot fill a socket buffer, so they can all go
+	// out before the receives. With io_uring the multishot receives keep draining both peers.
+	int queued[NP] = {0};
+	for (int k = 0; k < NP; k++) {
+		if (k == slot - 1 || !sendsQueued(peers[k])) continue;
+		queued[k] = 1;
+		sendAll(peers[k], wire[k], len);
+		sent[k] = len;
+	}
+	for (int k = 0; k < NP; k++) {
+		if (!queued[k]) continue;
+		if (recvAll(peers[k], rx[k], len) != (ssize_t)len) {
+			fprintf(stderr, "Agent %d left the mesh\n", k + 1);
+			exit(EXIT_FAILURE);
+		}
+		got[k] = len;
+	}
+	for (;;) {
+		struct pollfd fds[NP];
+		int party[NP], n = 0;
+		for (int k = 0; k < NP; k++) {
+			if (k == slot - 1 || (sent[k] == len && got[k] == len)) continue;
+			fds[n].fd = peers[k];
+			fds[n].events = (short)((sent[k] < len ? POLLOUT : 0) | (got[k] < len ? POLLIN : 0));
+			fds[n].revents = 0;
+			party[n++] = k;
+		}
+		if (n == 0) break;
+		if (poll(fds, (nfds_t)n, -1) < 0) {
+			if (errno == EINTR) continue;
+			perror("poll");
+			exit(EXIT_FAILURE);
+		}
+		for (int i = 0; i < n; i++) {
+			int k = party[i];
+			if (fds[i].revents & POLLOUT) {
+				ssize_t w = send(peers[k], wire[k] + sent[k], len - sent[k], MSG_DONTWAIT | MSG_NOSIGNAL);
+				if (w > 0) sent[k] += (size_t)w;
+				else if (errno != EAGAIN && errno != EWOULDBLOCK) {
+					perror("mesh send");
+					exit(EXIT_FAILURE);
+				}
+			}
+			if (fds[i].revents & (POLLIN | POLLHUP | POLLERR)) {
+				ssize_t r = recv(peers[k], rx[k] + got[k], len - got[k], MSG_DONTWAIT);
+				if (r > 0) got[k] += (size_t)r;
+				else if (r == 0 || (errno != EAGAIN && errno != EWOULDBLOCK)) {
+					fprintf(stderr, "Agent %d left the mesh\n", k + 1);
+					exit(EXIT_FAILURE);
+				}
+			}
+		}
+	}
+	for (int k = 0; k < NP; k++) {
+		if (k == slot - 1) continue;
+		if (!queued[k]) {
+			transcriptRecord(&recording, TRANSCRIPT_SENT, k + 1, wire[k], len);
+			transcriptRecord(&recording, TRANSCRIPT_RECEIVED, k + 1, rx[k], len);
+		}
+		if (packedTask) {
+			unpackValues((const uint8_t *)rx[k], count, in[k]);
+			continue;
+		}
+		for (uint32_t v = 0; v < count; v++) {
+			in[k][v] = (int32_t)ntohl((uint32_t)in[k][v]);
+		}
+	}
+}
 
-	send(fd, JOIN_MSG, 5, 0);
-	puts("JOIN sent – waiting for tasks");
+/*********************************************************************************
+ * @brief Reduce a layer of degree-2 shares to degree 1 among the agents.
+ * @param int32_t *values: shares to renormalize (modified in-place)
+ * @param uint32_t count: number of values
+ * @note Each agent reshares its share with a fresh degree-1 polynomial and sends party k
+ *       its point at k. The new share is the gamma-weighted sum of the points received,
+ *       so the secret is unchanged and the polynomial drops to degree 1 in one round.
+ *********************************************************************************/
+static void meshRenorm(int32_t *values, uint32_t count) {
+	static const int32_t gamma[NP] = {GAMMA1, GAMMA2, GAMMA3};
+	int32_t *sub[NP], *in[NP];
+	for (int k = 0; k < NP; k++) {
+		sub[k] = allocShares(count);
+		in[k] = (k == slot - 1) ? sub[k] : allocShares(count);
+	}
+	for (uint32_t v = 0; v < count; v++) {
+		int32_t coeff = randMod();
+		for (int k = 0; k < NP; k++) {
+			sub[k][v] = (values[v] + coeff * (k + 1)) % MOD;
+		}
+	}
+	exchangeWithPeers((const int32_t **)sub, in, count);
+	for (uint32_t v = 0; v < count; v++) {
+		int64_t sum = 0;
+		for (int j = 0; j < NP; j++) {
+			sum += (int64_t)gamma[j] * in[j][v];
+		}
+		values[v] = (int32_t)(sum % MOD);
+	}
+}
+
+/*********************************************************************************
+ * @brief Open a layer of shares among the agents: every agent learns the plain values.
+ * @param int32_t *values: shares to open, replaced by the public values
+ * @param uint32_t count: number of values
+ *********************************************************************************/
+static void meshOpen(int32_t *values, uint32_t count) {
+	static const int32_t gamma[NP] = {GAMMA1, GAMMA2, GAMMA3};
+	const int32_t *out[NP];
+	int32_t *in[NP];
+	for (int k = 0; k < NP; k++) {
+		out[k] = values;
+		in[k] = (k == slot - 1) ? values : allocShares(count);
+	}
+	exchangeWithPeers(out, in, count);
+	for (uint32_t v = 0; v < count; v++) {
+		int64_t sum = 0;
+		for (int j = 0; j < NP; j++) {
+			sum += (int64_t)gamma[j] * in[j][v];
+		}
+		values[v] = (int32_t)(sum % MOD);
+	}
+}
+
+/*********************************************************************************
+ * @brief Renormalize a whole layer of products in one round, among the agents when the
+ *        mesh is up and through the server otherwise.
+ * @param int32_t *values: values to renormalize (modified in-place)
+ * @param uint32_t count: number of values
+ *********************************************************************************/
+static void runRENORMBatch(int32_t *values, uint32_t count) {
+	if (count == 0) return;
+	if (meshActive) {
+		meshRenorm(values, count);
+		return;
+	}
+	sendFrame(OP_REN | OP_BATCH, packedTask ? WIDTH_PACKED : 0, values, count);
+	frame_t hdr;
+	if (recvAll(fd, &hdr, sizeof hdr) != sizeof hdr) {
+		fprintf(stderr, "Server left\n");
+		close(fd);
+		exit(EXIT_FAILURE);
+	}
+	if (hdr.op != (OP_REN | OP_BATCH) || ntohl(hdr.count) != count) {
+		fprintf(stderr, "RENORM batch did not have proper action code\n");
+		exit(EXIT_FAILURE);
+	}
+	recvValues(values, count, (hdr.width & WIDTH_PACKED) != 0);
+}
 
+/*********************************************************************************
+ * @brief Batched multiplication: n products sharing one renormalization round.
+ * @param const int32_t *vals: n shares of a followed by n shares of b
+ * @param uint32_t n: number of products
+ * @param int32_t *out: n product shares
+ *********************************************************************************/
+static void batchMUL(const int32_t *vals, uint32_t n, int32_t *out) {
+	for (uint32_t i = 0; i < n; i++) {
+		out[i] = (vals[i] * vals[n + i]) % MOD;
+	}
+	runRENORMBatch(out, n);
+}
+
+/*********************************************************************************
+ * @brief Finish n less than comparisons from their per-bit eq and lt shares.
+ * @param int32_t *eq: n*w shares of eq_j, MSB first (overwritten by the prefix scan)
+ * @param const int32_t *lt: n*w shares of lt_j
+ * @param uint32_t n: number of comparisons
+ * @param uint32_t w: bits per operand
+ * @param int32_t *out: n shares of sum_j prefixEq_j * lt_j
+ * @note Rounds: ceil(log2(w-1)) for the prefix product, one for the flags.
+ *********************************************************************************/
+static void prefixLT(int32_t *eq, const int32_t *lt, uint32_t n, uint32_t w, int32_t *out) {
+	int32_t *tmp = allocShares((size_t)n * w);
+
+	// Inclusive prefix product of eq over the first w-1 bits (Hillis-Steele scan)
+	for (uint32_t d = 1; d + 1 < w; d <<= 1) {
+		uint32_t c = 0;
+		for (uint32_t i = 0; i < n; i++) {
+			for (uint32_t j = d; j + 1 < w; j++) {
+				tmp[c++] = (eq[i * w + j] * eq[i * w + j - d]) % MOD;
+			}
+		}
+		runRENORMBatch(tmp, c);
+		c = 0;
+		for (uint32_t i = 0; i < n; i++) {
+			for (uint32_t j = d; j + 1 < w; j++) {
+				eq[i * w + j] = tmp[c++];
+			}
+		}
+	}
+
+	// flag_j = prefixEq_j * lt_j, where prefixEq_j = eq[j-1] after the scan and prefixEq_0 = 1
+	uint32_t c = 0;
+	for (uint32_t i = 0; i < n; i++) {
+		for (uint32_t j = 1; j < w; j++) {
+			tmp[c++] = (eq[i * w + j - 1] * lt[i * w + j]) % MOD;
+		}
+	}
+	runRENORMBatch(tmp, c);
+	c = 0;
+	for (uint32_t i = 0; i < n; i++) {
+		out[i] = lt[i * w];
+		for (uint32_t j = 1; j < w; j++) {
+			out[i] = (out[i] + tmp[c++]) % MOD;
+		}
+	}
+}
+
+/*********************************************************************************
+ * @brief Multiply each row of w terms down to one share with a log-depth product tree.
+ * @param int32_t *terms: n*w shares, overwritten
+ * @param uint32_t n: number of rows
+ * @param uint32_t w: terms per row
+ * @param int32_t *out: n shares of the row products
+ * @note Rounds: ceil(log2(w)). An odd last term carries over to the next level unchanged.
+ *********************************************************************************/
+static void productTree(int32_t *terms, uint32_t n, uint32_t w, int32_t *out) {
+	int32_t *prod = allocShares((size_t)n * w);
+	for (uint32_t len = w; len > 1; len = (len + 1) / 2) {
+		uint32_t half = len / 2, next = (len + 1) / 2, c = 0;
+		for (uint32_t i = 0; i < n; i++) {
+			for (uint32_t j = 0; j < half; j++) {
+				prod[c++] = (terms[(size_t)i * len + 2 * j] * terms[(size_t)i * len + 2 * j + 1]) % MOD;
+			}
+		}
+		runRENORMBatch(prod, c);
+		for (uint32_t i = 0; i < n; i++) {
+			int32_t carry = terms[(size_t)i * len + len - 1];
+			for (uint32_t j = 0; j < half; j++) {
+				terms[(size_t)i * next + j] = prod[(size_t)i * half + j];
+			}
+			if (len % 2) terms[(size_t)i * next + half] = carry;
+		}
+	}
+	for (uint32_t i = 0; i < n; i++) {
+		out[i] = terms[i];
+	}
+}
+
+/*********************************************************************************
+ * @brief Batched less than: shares of [u < v] for n pairs of w-bit operands.
+ * @param const int32_t *vals: n*w bit shares of u followed by n*w bit shares of v, MSB first
+ * @param uint32_t n: number of comparisons
+ * @param uint32_t w: bits per operand
+ * @param int32_t *out: n result shares
+ * @note Rounds: one for u_j*v_j, then the prefix chain of prefixLT.
+ *********************************************************************************/
+static void batchLT(const int32_t *vals, uint32_t n, uint32_t w, int32_t *out) {
+	const int32_t *u = vals, *v = vals + (size_t)n * w;
+	size_t total = (size_t)n * w;
+	int32_t *uv = allocShares(total);
+	int32_t *eq = allocShares(total);
+	int32_t *lt = allocShares(total);
+
+	// [u_j*v_j] for every bit of every comparison in one round
+	for (size_t k = 0; k < total; k++) {
+		uv[k] = (u[k] * v[k]) % MOD;
+	}
+	runRENORMBatch(uv, total);
+
+	// eq_j = 1 - u_j - v_j + 2u_jv_j and lt_j = v_j - u_jv_j are linear once u_jv_j is known
+	for (size_t k = 0; k < total; k++) {
+		eq[k] = (1 - u[k] - v[k] + 2 * uv[k] + 2 * MOD) % MOD;
+		lt[k] = (v[k] - uv[k] + MOD) % MOD;
+	}
+	prefixLT(eq, lt, n, w, out);
+}
+
+/*********************************************************************************
+ * @brief Batched less than against public constants: shares of [u < c].
+ * @param const int32_t *vals: n*w bit shares of u, MSB first, followed by the n public c
+ * @param uint32_t n: number of comparisons
+ * @param uint32_t w: bits per operand
+ * @param int32_t *out: n result shares
+ * @note With c_j known, eq_j and lt_j are linear in u_j, so only the prefix chain and
+ *       the final flags need renormalization.
+ *********************************************************************************/
+static void batchLTC(const int32_t *vals, uint32_t n, uint32_t w, int32_t *out) {
+	const int32_t *u = vals, *c = vals + (size_t)n * w;
+	size_t total = (size_t)n * w;
+	int32_t *eq = allocShares(total);
+	int32_t *lt = allocShares(total);
+
+	for (uint32_t i = 0; i < n; i++) {
+		for (uint32_t j = 0; j < w; j++) {
+			size_t k = (size_t)i * w + j;
+			int32_t cj = (c[i] >> (w - 1 - j)) & 1;
+			eq[k] = cj ? u[k] : (1 - u[k] + MOD) % MOD;
+			lt[k] = cj ? (1 - u[k] + MOD) % MOD : 0;
+		}
+	}
+	prefixLT(eq, lt, n, w, out);
+}
+
+/*********************************************************************************
+ * @brief Batched equality: shares of [u == v] for n pairs of w-bit operands.
+ * @param const int32_t *vals: n*w bit shares of u followed by n*w bit shares of v
+ * @param uint32_t n: number of comparisons
+ * @param uint32_t w: bits per operand
+ * @param int32_t *out: n result shares
+ * @note Rounds: one for u_j*v_j, then ceil(log2(w)) for a product tree over the per-bit
+ *       XNORs. No gt/lt products and no sequential prefix chain.
+ *********************************************************************************/
+static void batchEQ(const int32_t *vals, uint32_t n, uint32_t w, int32_t *out) {
+	const int32_t *u = vals, *v = vals + (size_t)n * w;
+	size_t total = (size_t)n * w;
+	int32_t *terms = allocShares(total);
+
+	for (size_t k = 0; k < total; k++) {
+		terms[k] = (u[k] * v[k]) % MOD;
+	}
+	runRENORMBatch(terms, total);
+	// xnor_j = 1 - u_j - v_j + 2u_jv_j
+	for (size_t k = 0; k < total; k++) {
+		terms[k] = (1 - u[k] - v[k] + 2 * terms[k] + 2 * MOD) % MOD;
+	}
+	productTree(terms, n, w, out);
+}
+
+/*********************************************************************************
+ * @brief Batched equality against public constants: shares of [u == c].
+ * @param const int32_t *vals: n*w bit shares of u, MSB first, followed by the n public c
+ * @param uint32_t n: number of comparisons
+ * @param uint32_t w: bits per operand
+ * @param int32_t *out: n result shares
+ * @note The per-bit XNORs are linear, so only the product tree needs renormalization.
+ *********************************************************************************/
+static void batchEQC(const int32_t *vals, uint32_t n, uint32_t w, int32_t *out) {
+	const int32_t *u = vals, *c = vals + (size_t)n * w;
+	int32_t *terms = allocShares((size_t)n * w);
+
+	for (uint32_t i = 0; i < n; i++) {
+		for (uint32_t j = 0; j < w; j++) {
+			size_t k = (size_t)i * w + j;
+			terms[k] = ((c[i] >> (w - 1 - j)) & 1) ? u[k] : (1 - u[k] + MOD) % MOD;
+		}
+	}
+	productTree(terms, n, w, out);
+}
+
+/*********************************************************************************
+ * @brief Open a layer of shares in one round, among the agents when the mesh is up and
+ *        through the server otherwise.
+ * @param int32_t *values: shares to open, replaced by the public values
+ * @param uint32_t count: number of values
+ * @note The shares may be of degree 2; the server reconstructs and returns the plain values.
+ *********************************************************************************/
+static void runOPENBatch(int32_t *values, uint32_t count) {
+	if (count == 0) return;
+	if (meshActive) {
+		meshOpen(values, count);
+		return;
+	}
+	sendFrame(OP_OPN | OP_BATCH, packedTask ? WIDTH_PACKED : 0, values, count);
+	frame_t hdr;
+	if (recvAll(fd, &hdr, sizeof hdr) != sizeof hdr) {
+		fprintf(stderr, "Server left\n");
+		close(fd);
+		exit(EXIT_FAILURE);
+	}
+	if (hdr.op != (OP_OPN | OP_BATCH) || ntohl(hdr.count) != count) {
+		fprintf(stderr, "OPEN batch did not have proper action code\n");
+		exit(EXIT_FAILURE);
+	}
+	recvValues(values, count, (hdr.width & WIDTH_PACKED) != 0);
+}
+
+/*********************************************************************************
+ * @brief Modular exponentiation.
+ *********************************************************************************/
+static int32_t powMod(int32_t base, int32_t e) {
+	int64_t result = 1, b = base % MOD;
+	while (e > 0) {
+		if (e & 1) result = result * b % MOD;
+		b = b * b % MOD;
+		e >>= 1;
+	}
+	return (int32_t)result;
+}
+
+/*********************************************************************************
+ * @brief Constant-round zero test on values known to lie in [0, D].
+ * @param const int32_t *y: count shares to test
+ * @param uint32_t count: number of tests
+ * @param uint32_t D: largest possible value
+ * @param const int32_t *masks: count preprocessed masks of D + 2 shares each:
+ *        [m], [m^-1] ... [m^-D], and a degree-2 sharing of zero
+ * @param int32_t *out: count shares of [y == 0], may alias y
+ * @note One round: e = (y + 1) * m is opened, which hides y because m is a random nonzero
+ *       value. Then [(y + 1)^i] = e^i * [m^-i] is local, and the polynomial that is 1 at
+ *       y + 1 = 1 and 0 at 2 ... D + 1 gives the result.
+ *********************************************************************************/
+static void zeroTest(const int32_t *y, uint32_t count, uint32_t D, const int32_t *masks, int32_t *out) {
+	const uint32_t stride = D + 2;
+	int32_t *e = allocShares(count);
+	int32_t *alpha = allocShares(D + 1);
+
+	for (uint32_t k = 0; k < count; k++) {
+		const int32_t *mk = masks + (size_t)k * stride;
+		e[k] = (((y[k] + 1) % MOD) * mk[0] + mk[D + 1]) % MOD;
+	}
+	runOPENBatch(e, count);
+
+	// alpha = coefficients of prod_{t=2}^{D+1} (x - t) / (1 - t)
+	memset(alpha, 0, (D + 1) * sizeof(int32_t));
+	alpha[0] = 1;
+	for (uint32_t t = 2; t <= D + 1; t++) {
+		int32_t scale = powMod((int32_t)((1 - (int32_t)t + MOD) % MOD), MOD - 2);
+		for (uint32_t i = t - 1; i > 0; i--) {
+			alpha[i] = (alpha[i - 1] + (int32_t)((int64_t)alpha[i] * (MOD - t) % MOD)) % MOD;
+		}
+		alpha[0] = (int32_t)((int64_t)alpha[0] * (MOD - t) % MOD);
+		for (uint32_t i = 0; i < t; i++) {
+			alpha[i] = (int32_t)((int64_t)alpha[i] * scale % MOD);
+		}
+	}
+
+	for (uint32_t k = 0; k < count; k++) {
+		const int32_t *mk = masks + (size_t)k * stride;
+		int64_t acc = alpha[0], ePow = 1;
+		for (uint32_t i = 1; i <= D; i++) {
+			ePow = ePow * e[k] % MOD;
+			acc = (acc + (int64_t)alpha[i] * (ePow * mk[i] % MOD)) % MOD;
+		}
+		out[k] = (int32_t)acc;
+	}
+}
+
+/*********************************************************************************
+ * @brief Turn per-bit difference indicators into "first difference" flags in constant rounds.
+ * @param const int32_t *x: n*w shares of [bit j differs], MSB first
+ * @param uint32_t n: number of comparisons
+ * @param uint32_t w: bits per operand
+ * @param const int32_t *masks: n*w zero-test masks of degree w
+ * @param int32_t *first: n*w shares, 1 only at the most significant differing bit
+ * @note The prefix sums of x are linear. Each is zero-tested in the same round, which
+ *       replaces the log-depth prefix product of prefixLT.
+ *********************************************************************************/
+static void firstDifference(const int32_t *x, uint32_t n, uint32_t w, const int32_t *masks, int32_t *first) {
+	size_t total = (size_t)n * w;
+	for (uint32_t i = 0; i < n; i++) {
+		int32_t run = 0;
+		for (uint32_t j = 0; j < w; j++) {
+			run = (run + x[(size_t)i * w + j]) % MOD;
+			first[(size_t)i * w + j] = run;
+		}
+	}
+	zeroTest(first, total, w, masks, first);
+	// prefixOr_j = 1 - [sum_j == 0], first_j = prefixOr_j - prefixOr_{j-1}
+	for (uint32_t i = 0; i < n; i++) {
+		int32_t prevOr = 0;
+		for (uint32_t j = 0; j < w; j++) {
+			size_t k = (size_t)i * w + j;
+			int32_t prefixOr = (1 - first[k] + MOD) % MOD;
+			first[k] = (prefixOr - prevOr + MOD) % MOD;
+			prevOr = prefixOr;
+		}
+	}
+}
+
+/*********************************************************************************
+ * @brief Per-bit XOR shares of two shared bit vectors, using one renormalization round.
+ *********************************************************************************/
+static void sharedXor(const int32_t *u, const int32_t *v, size_t total, int32_t *x) {
+	for (size_t k = 0; k < total; k++) {
+		x[k] = (u[k] * v[k]) % MOD;
+	}
+	runRENORMBatch(x, total);
+	for (size_t k = 0; k < total; k++) {
+		x[k] = (u[k] + v[k] - 2 * x[k] + 2 * MOD) % MOD;
+	}
+}
+
+/*********************************************************************************
+ * @brief Constant-round less than with preprocessed masks: shares of [u < v].
+ * @param const int32_t *vals: n*w bit shares of u, then n*w bit shares of v
+ * @param const int32_t *masks: n*w zero-test masks of degree w
+ * @note Rounds: XOR products, one zero-test opening, first-difference times v_j.
+ *********************************************************************************/
+static void batchLTPre(const int32_t *vals, const int32_t *masks, uint32_t n, uint32_t w, int32_t *out) {
+	size_t total = (size_t)n * w;
+	const int32_t *u = vals, *v = vals + total;
+	int32_t *x = allocShares(total);
+	int32_t *first = allocShares(total);
+
+	sharedXor(u, v, total, x);
+	firstDifference(x, n, w, masks, first);
+	for (size_t k = 0; k < total; k++) {
+		x[k] = (first[k] * v[k]) % MOD;
+	}
+	runRENORMBatch(x, total);
+	for (uint32_t i = 0; i < n; i++) {
+		out[i] = 0;
+		for (uint32_t j = 0; j < w; j++) {
+			out[i] = (out[i] + x[(size_t)i * w + j]) % MOD;
+		}
+	}
+}
+
+/*********************************************************************************
+ * @brief Constant-round less than against public constants: shares of [u < c].
+ * @param const int32_t *vals: n*w bit shares of u, then the n public c
+ * @param const int32_t *masks: n*w zero-test masks of degree w
+ * @note One round: the XORs and the final selection of c_j are linear.
+ *********************************************************************************/
+static void batchLTCPre(const int32_t *vals, const int32_t *masks, uint32_t n, uint32_t w, int32_t *out) {
+	size_t total = (size_t)n * w;
+	const int32_t *u = vals, *c = vals + total;
+	int32_t *x = allocShares(total);
+	int32_t *first = allocShares(total);
+
+	for (uint32_t i = 0; i < n; i++) {
+		for (uint32_t j = 0; j < w; j++) {
+			size_t k = (size_t)i * w + j;
+			x[k] = ((c[i] >> (w - 1 - j)) & 1) ? (1 - u[k] + MOD) % MOD : u[k];
+		}
+	}
+	firstDifference(x, n, w, masks, first);
+	for (uint32_t i = 0; i < n; i++) {
+		out[i] = 0;
+		for (uint32_t j = 0; j < w; j++) {
+			if ((c[i] >> (w - 1 - j)) & 1) out[i] = (out[i] + first[(size_t)i * w + j]) % MOD;
+		}
+	}
+}
+
+/*********************************************************************************
+ * @brief Constant-round equality with preprocessed masks: shares of [u == v].
+ * @param const int32_t *vals: n*w bit shares of u, then n*w bit shares of v
+ * @param const int32_t *masks: n zero-test masks of degree w
+ * @note Rounds: XOR products and one zero-test opening of the number of differing bits.
+ *********************************************************************************/
+static void batchEQPre(const int32_t *vals, const int32_t *masks, uint32_t n, uint32_t w, int32_t *out) {
+	size_t total = (size_t)n * w;
+	const int32_t *u = vals, *v = vals + total;
+	int32_t *x = allocShares(total);
+
+	sharedXor(u, v, total, x);
+	for (uint32_t i = 0; i < n; i++) {
+		int32_t diff = 0;
+		for (uint32_t j = 0; j < w; j++) {
+			diff = (diff + x[(size_t)i * w + j]) % MOD;
+		}
+		x[i] = diff;
+	}
+	zeroTest(x, n, w, masks, out);
+}
+
+/*********************************************************************************
+ * @brief Constant-round equality against public constants: shares of [u == c].
+ * @param const int32_t *vals: n*w bit shares of u, then the n public c
+ * @param const int32_t *masks: n zero-test masks of degree w
+ * @note One round: the zero-test opening.
+ *********************************************************************************/
+static void batchEQCPre(const int32_t *vals, const int32_t *masks, uint32_t n, uint32_t w, int32_t *out) {
+	size_t total = (size_t)n * w;
+	const int32_t *u = vals, *c = vals + total;
+	int32_t *diff = allocShares(n);
+
+	for (uint32_t i = 0; i < n; i++) {
+		diff[i] = 0;
+		for (uint32_t j = 0; j < w; j++) {
+			size_t k = (size_t)i * w + j;
+			int32_t x = ((c[i] >> (w - 1 - j)) & 1) ? (1 - u[k] + MOD) % MOD : u[k];
+			diff[i] = (diff[i] + x) % MOD;
+		}
+	}
+	zeroTest(diff, n, w, masks, out);
+}
+
+/*********************************************************************************
+ * @brief Batched matrix product: every output is a local sum of share products,
+ *        renormalized together in one round.
+ * @param const int32_t *vals: public n, k, m, then n*k shares of A (row major)
+ * @param const int32_t *b: k*m shares of B (row major), from the payload or the kept matrix
+ * @param int32_t *out: n*m result shares
+ * @note The sum of degree-2 products is still degree 2, so one renormalization per output
+ *       is enough. Loops are tiled so a block of B stays in cache while rows of A stream by.
+ *********************************************************************************/
+static void batchDOT(const int32_t *vals, const int32_t *b, int32_t *out) {
+	uint32_t n = (uint32_t)vals[0], k = (uint32_t)vals[1], m = (uint32_t)vals[2];
+	const int32_t *a = vals + 3;
+	int64_t *acc = arenaAlloc((size_t)n * m * sizeof(int64_t));
+	memset(acc, 0, (size_t)n * m * sizeof(int64_t));
+
+	for (uint32_t ii = 0; ii < n; ii += DOT_TILE) {
+		for (uint32_t pp = 0; pp < k; pp += DOT_TILE) {
+			for (uint32_t jj = 0; jj < m; jj += DOT_TILE) {
+				uint32_t iEnd = ii + DOT_TILE < n ? ii + DOT_TILE : n;
+				uint32_t pEnd = pp + DOT_TILE < k ? pp + DOT_TILE : k;
+				uint32_t jEnd = jj + DOT_TILE < m ? jj + DOT_TILE : m;
+				for (uint32_t i = ii; i < iEnd; i++) {
+					int64_t *row = acc + (size_t)i * m;
+					for (uint32_t p = pp; p < pEnd; p++) {
+						const int64_t aip = a[(size_t)i * k + p];
+						const int32_t *brow = b + (size_t)p * m;
+						for (uint32_t j = jj; j < jEnd; j++) {
+							row[j] += aip * brow[j];
+						}
+					}
+				}
+			}
+		}
+	}
+
+	for (size_t c = 0; c < (size_t)n * m; c++) {
+		out[c] = (int32_t)(acc[c] % MOD);
+	}
+	runRENORMBatch(out, n * m);
+}
+
+/*********************************************************************************
+ * @brief Map an agent's store for one width, replacing any earlier mapping.
+ * @param pool_t *pool: store to map, fd already open
+ * @param uint32_t w: comparison width
+ *********************************************************************************/
+static void mapPool(pool_t *pool, uint32_t w) {
+	if (pool->hdr) munmap(pool->hdr, sizeof(pool_header_t) + pool->mapped * POOL_STRIDE(w) * sizeof(int32_t));
+	pool_header_t head;
+	if (pread(pool->fd, &head, sizeof head, 0) != (ssize_t)sizeof head) {
+		fprintf(stderr, "Preprocessing store for width %u is truncated\n", w);
+		exit(EXIT_FAILURE);
+	}
+	uint64_t capacity = atomic_load_explicit(&head.capacity, memory_order_relaxed);
+	size_t bytes = sizeof(pool_header_t) + capacity * POOL_STRIDE(w) * sizeof(int32_t);
+	// A replay maps the store read-only so it cannot disturb the live agents
+	void *p = mmap(NULL, bytes, replaying ? PROT_READ : PROT_READ | PROT_WRITE, replaying ? MAP_PRIVATE : MAP_SHARED, pool->fd, 0);
+	if (p == MAP_FAILED) {
+		perror("mmap");
+		exit(EXIT_FAILURE);
+	}
+	pool->hdr = (pool_header_t *)p;
+	pool->mapped = capacity;
+}
+
+/*********************************************************************************
+ * @brief Take count zero-test masks of degree w from the agent's preprocessing store.
+ * @param uint32_t w: comparison width
+ * @param size_t count: number of masks
+ * @return const int32_t *: the masks, read in place from the mapped file
+ * @note The store is opened on first use and remapped when the dealer has appended to it.
+ *       A replay reads the masks after the store's current cursor and only advances a local
+ *       copy, so live agents sharing the store stay aligned.
+ *********************************************************************************/
+static const int32_t *takeMasks(uint32_t w, size_t count) {
+	if (!poolDir || w > l) {
+		fprintf(stderr, "Server requested stored masks, but no preprocessing store was given\n");
+		exit(EXIT_FAILURE);
+	}
+	pool_t *pool = &pools[w];
+	if (!pool->hdr) {
+		char path[4096];
+		poolPath(path, sizeof path, poolDir, agentIndex, (int)w);
+		pool->fd = open(path, replaying ? O_RDONLY : O_RDWR);
+		if (pool->fd < 0) {
+			perror(path);
+			exit(EXIT_FAILURE);
+		}
+		mapPool(pool, w);
+		if (memcmp(pool->hdr->magic, POOL_MAGIC, sizeof pool->hdr->magic) != 0 || pool->hdr->agent != (uint32_t)agentIndex || pool->hdr->degree != w) {
+			fprintf(stderr, "%s is not a width %u store for agent %d\n", path, w, agentIndex);
+			exit(EXIT_FAILURE);
+		}
+		printf("Preprocessing store for width %u: %llu masks left\n", w,
+		       (unsigned long long)(atomic_load(&pool->hdr->capacity) - atomic_load(&pool->hdr->cursor)));
+		pool->cursor = atomic_load(&pool->hdr->cursor);
+	}
+	uint64_t cursor = replaying ? pool->cursor : atomic_load_explicit(&pool->hdr->cursor, memory_order_relaxed);
+	if (cursor + count > pool->mapped) {
+		uint64_t capacity = atomic_load_explicit(&pool->hdr->capacity, memory_order_acquire);
+		if (cursor + count > capacity) {
+			fprintf(stderr, "Preprocessing store for width %u exhausted: %llu masks left, %zu needed\n", w,
+			        (unsigned long long)(capacity - cursor), count);
+			exit(EXIT_FAILURE);
+		}
+		mapPool(pool, w);
+	}
+	if (replaying) {
+		pool->cursor = cursor + count;
+	} else {
+		atomic_fetch_add_explicit(&pool->hdr->cursor, count, memory_order_release);
+	}
+	return (const int32_t *)(pool->hdr + 1) + cursor * POOL_STRIDE(w);
+}
+
+/*********************************************************************************
+ * @brief Keep shares of a matrix for later products, replacing any kept before.
+ * @param const int32_t *vals: public k, m, then k*m shares (row major)
+ * @param uint32_t count: number of values
+ * @note Lets the server deal a matrix that many tasks multiply by only once. The frame
+ *       has no reply, the next task's results follow it in order.
+ *********************************************************************************/
+static void keepMatrix(const int32_t *vals, uint32_t count) {
+	if (count < 2 || vals[0] < 0 || vals[1] < 0 || count != 2 + (uint64_t)vals[0] * (uint64_t)vals[1]) {
+		fprintf(stderr, "Malformed KEEP frame\n");
+		exit(EXIT_FAILURE);
+	}
+	free(kept);
+	kept = malloc(((size_t)count - 2) * sizeof(int32_t) + 1);
+	if (!kept) {
+		perror("malloc");
+		exit(EXIT_FAILURE);
+	}
+	memcpy(kept, vals + 2, ((size_t)count - 2) * sizeof(int32_t));
+	keptRows = (uint32_t)vals[0];
+	keptCols = (uint32_t)vals[1];
+}
+
+/*********************************************************************************
+ * @brief Process one batched task and send its results.
+ * @param frame_t *hdr: task header, count already in host byte order
+ * @param const int32_t *vals: task payload
+ *********************************************************************************/
+static void runBatchTask(const frame_t *hdr, const int32_t *vals) {
+	uint8_t op = hdr->op & ~(OP_BATCH | OP_PRE | OP_STORE);
+	int pre = (hdr->op & OP_PRE) != 0;
+	int stored = (hdr->op & OP_STORE) != 0;
+	uint32_t w = (hdr->width & ~(WIDTH_SUM | WIDTH_PACKED)) ? (hdr->width & ~(WIDTH_SUM | WIDTH_PACKED)) : 1;
+	packedTask = (hdr->width & WIDTH_PACKED) != 0;
+	uint32_t mask = stored ? 0 : w + 2; // payload shares per zero-test mask of degree w
+	uint32_t n = hdr->count / 2;
+	if (op == OP_LT) {
+		n = hdr->count / (pre ? 2 * w + w * mask : 2 * w);
+	} else if (op == OP_EQL) {
+		n = hdr->count / (pre ? 2 * w + mask : 2 * w);
+	} else if (op == OP_LTC) {
+		n = hdr->count / (pre ? w + 1 + w * mask : w + 1);
+	} else if (op == OP_EQC) {
+		n = hdr->count / (pre ? w + 1 + mask : w + 1);
+	} else if (op == OP_DOT) {
+		// Dimensions come from the wire: check them in 64 bits before they size anything.
+		// Zero is allowed, and an empty product is all zeros. With OP_STORE the right
+		// operand is the kept matrix, which must have the announced shape.
+		uint64_t right = stored ? 0 : (uint64_t)vals[1] * (uint64_t)vals[2];
+		if (hdr->count < 3 || vals[0] < 0 || vals[1] < 0 || vals[2] < 0 ||
+		    hdr->count != 3 + (uint64_t)vals[0] * (uint64_t)vals[1] + right ||
+		    (uint64_t)vals[0] * (uint64_t)vals[2] > UINT32_MAX ||
+		    (stored && ((uint32_t)vals[1] != keptRows || (uint32_t)vals[2] != keptCols))) {
+			fprintf(stderr, "Malformed DOT batch\n");
+			exit(EXIT_FAILURE);
+		}
+		n = (uint32_t)vals[0] * (uint32_t)vals[2];
+	}
+	const int32_t *masks = NULL;
+	if (pre) {
+		size_t inputs = (op == OP_LT || op == OP_EQL) ? 2 * (size_t)n * w : (size_t)n * (w + 1);
+		size_t count = (op == OP_LT || op == OP_LTC) ? (size_t)n * w : n;
+		masks = stored ? takeMasks(w, count) : vals + inputs;
+	}
+	int32_t *out = allocShares(n ? n : 1); // A reduction of nothing still returns one share
+	if (op == OP_MUL) {
+		batchMUL(vals, n, out);
+	} else if (op == OP_LT) {
+		if (pre) batchLTPre(vals, masks, n, w, out);
+		else batchLT(vals, n, w, out);
+	} else if (op == OP_LTC) {
+		if (pre) batchLTCPre(vals, masks, n, w, out);
+		else batchLTC(vals, n, w, out);
+	} else if (op == OP_EQL) {
+		if (pre) batchEQPre(vals, masks, n, w, out);
+		else batchEQ(vals, n, w, out);
+	} else if (op == OP_EQC) {
+		if (pre) batchEQCPre(vals, masks, n, w, out);
+		else batchEQC(vals, n, w, out);
+	} else if (op == OP_DOT) {
+		batchDOT(vals, stored ? kept : vals + 3 + (size_t)vals[0] * (size_t)vals[1], out);
+	} else {
+		fprintf(stderr, "Unknown batch op 0x%02x\n", hdr->op);
+		exit(EXIT_FAILURE);
+	}
+	if (hdr->width & WIDTH_SUM) {
+		// Reductions reveal only the total, summed locally on the shares
+		int64_t total = 0;
+		for (uint32_t i = 0; i < n; i++) {
+			total += out[i];
+		}
+		out[0] = (int32_t)(total % MOD);
+		n = 1;
+	}
+	sendFrame(OP_RES | OP_BATCH, hdr->width, out, n);
+}
+
+/*********************************************************************************
+ * @brief Process tasks from the server until it disconnects.
+ *********************************************************************************/
+static void serve(void) {
 	for (;;) {
 		task_t t;
-		if (recvAll(fd, &t, sizeof t) != sizeof t) break;
+		if (recvAll(fd, &t.op, sizeof t.op) != sizeof t.op) break;
+		if (t.op & OP_BATCH) {
+			frame_t hdr = {t.op, 0, 0};
+			if (recvAll(fd, (char *)&hdr + sizeof hdr.op, sizeof hdr - sizeof hdr.op) != sizeof hdr - sizeof hdr.op) break;
+			int32_t *vals = recvPayload(&hdr);
+			if (hdr.op == (OP_MESH | OP_BATCH)) {
+				// The server first sends the peer list, then whether to use the mesh
+				if (hdr.count == 1) {
+					meshActive = vals[0] != 0;
+					puts(meshActive ? "Agent mesh active" : "Renormalizing through the server");
+				} else {
+					int32_t ok = setupMesh(vals, hdr.count);
+					sendFrame(OP_MESH | OP_BATCH, 0, &ok, 1);
+				}
+			} else if (hdr.op == (OP_KEEP | OP_BATCH)) {
+				keepMatrix(vals, hdr.count);
+			} else {
+				runBatchTask(&hdr, vals);
+			}
+			arenaReset();
+			continue;
+		}
+		if (recvAll(fd, (char *)&t + sizeof t.op, sizeof t - sizeof t.op) != sizeof t - sizeof t.op) break;
 		if (t.op == OP_ADD) {
 			int32_t x = (int32_t)ntohl(t.a);
 			int32_t y = (int32_t)ntohl(t.b);
 			int32_t res = (x + y) % MOD;
 			response_t r = {OP_RES, htonl((uint32_t)res)};
-			if (send(fd, &r, sizeof r, 0) != sizeof r) {
+			if (sendAll(fd, &r, sizeof r) != sizeof r) {
 				perror("send");
 				exit(EXIT_FAILURE);
 			}
@@ -162,7 +1459,7 @@ int main(int argc, char **argv) {
 			int32_t y = (int32_t)ntohl(t.b);
 			int32_t res = (x * y) % MOD;
 			response_t r = {OP_RES, htonl((uint32_t)res)};
-			if (send(fd, &r, sizeof r, 0) != sizeof r) {
+			if (sendAll(fd, &r, sizeof r) != sizeof r) {
 				perror("send");
 				exit(EXIT_FAILURE);
 			}
@@ -208,13 +1505,88 @@ int main(int argc, char **argv) {
 			}
 
 			response_t r = {OP_RES, htonl((uint32_t)cmp_share)};
-			if (send(fd, &r, sizeof r, 0) != sizeof r) {
+			if (sendAll(fd, &r, sizeof r) != sizeof r) {
 				perror("send");
 				exit(EXIT_FAILURE);
 			}
 		}
 	}
+}
+
+static void usage(const char *prog) {
+	fprintf(stderr,
+	        "usage: %s [-r <transcript>] <server-ip> <port> [<agent-index> <store-dir>]\n"
+	        "       %s -R <transcript> [<agent-index> <store-dir>]     replay a recorded session offline\n",
+	        prog, prog);
+	exit(EXIT_FAILURE);
+}
+
+/*********************************************************************************
+ * @brief Main function for the agent that connects to the server and processes tasks.
+ * @param int argc: number of command line arguments
+ * @param char **argv: command line arguments
+ * @return int: exit status
+ *********************************************************************************/
+int main(int argc, char **argv) {
+	const char *recordPath = NULL, *replayPath = NULL;
+	int opt;
+	while ((opt = getopt(argc, argv, "r:R:")) != -1) {
+		if (opt == 'r') recordPath = optarg;
+		else if (opt == 'R') replayPath = optarg;
+		else usage(argv[0]);
+	}
+	int positional = replayPath ? 0 : 2; // Server address and port
+	int args = argc - optind;
+	if (args != positional && args != positional + 2) usage(argv[0]);
+	if (args == positional + 2) {
+		agentIndex = atoi(argv[optind + positional]);
+		poolDir = argv[optind + positional + 1];
+		if (agentIndex < 1 || agentIndex > NP) {
+			fprintf(stderr, "Agent index must be between 1 and %d\n", NP);
+			return 1;
+		}
+	}
+
+	if (replayPath) {
+		if (transcriptMap(&replay, replayPath) != TRANSCRIPT_AGENT) {
+			fprintf(stderr, "%s is not an agent transcript\n", replayPath);
+			return 1;
+		}
+		replaying = 1;
+		fd = -2; // Stands for the server's connection in the transcript
+		uint64_t start = transcriptNow();
+		serve();
+		printf("Replayed %s in %.3f ms, recorded over %.3f ms\n", replayPath, (double)(transcriptNow() - start) / 1e6,
+		       (double)transcriptDuration(&replay) / 1e6);
+		return 0;
+	}
+
+	fd = lookup_and_connect(argv[optind], argv[optind + 1]);
+	if (fd < 0) return 1;
+
+	// The join line names the slot an agent with stored shares needs (0 for any) and the
+	// port other agents reach it on
+	int meshPort = openMeshListener();
+	if (agentIndex || meshPort > 0) {
+		char join[32];
+		int len = snprintf(join, sizeof join, "JOIN %d %d\n", agentIndex, meshPort > 0 ? meshPort : 0);
+		send(fd, join, len, 0);
+	} else {
+		send(fd, JOIN_MSG, 5, 0);
+	}
+	puts("JOIN sent – waiting for tasks");
+#ifdef NETINT_URING
+	puts(netringInit(fd) == 0 ? "Using io_uring" : "io_uring unavailable, using send and recv");
+#endif
+
+	if (recordPath && transcriptCreate(&recording, recordPath, TRANSCRIPT_AGENT) != 0) {
+		perror(recordPath);
+		return 1;
+	}
+
+	serve();
 	puts("Server closed – bye");
+	transcriptClose(&recording);
 	close(fd);
 	return 0;
 }
\ No newline at end of file
@@ -0,0 +1,265 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/random.h>
+#include <unistd.h>
+
+#include "dealer.h"
+
+#define MOD 10289
+#define l 14
+#define CHUNK 4096
+
+/*********************************************************************************
+ * @brief Uniform value in [lo, MOD) from the kernel's random source.
+ * @param int32_t lo: smallest value, 0 or 1
+ * @return int32_t: random value
+ *********************************************************************************/
+static int32_t randMod(int32_t lo) {
+	static uint32_t buf[1024];
+	static size_t left = 0;
+	const uint32_t span = (uint32_t)(MOD - lo);
+	const uint32_t limit = UINT32_MAX - UINT32_MAX % span;
+	for (;;) {
+		if (left == 0) {
+			if (getrandom(buf, sizeof buf, 0) != (ssize_t)sizeof buf) {
+				perror("getrandom");
+				exit(EXIT_FAILURE);
+			}
+			left = sizeof buf / sizeof buf[0];
+		}
+		uint32_t r = buf[--left];
+		if (r < limit) return lo + (int32_t)(r % span);
+	}
+}
+
+/*********************************************************************************
+ * @brief Modular exponentiation.
+ *********************************************************************************/
+static int32_t powMod(int32_t base, int32_t e) {
+	int64_t result = 1, b = base % MOD;
+	while (e > 0) {
+		if (e & 1) result = result * b % MOD;
+		b = b * b % MOD;
+		e >>= 1;
+	}
+	return (int32_t)result;
+}
+
+/*********************************************************************************
+ * @brief Deal one zero-test mask, writing each agent's shares to its record.
+ * @param int degree: mask degree
+ * @param int32_t *records[3]: per-agent output, POOL_STRIDE(degree) values each
+ *********************************************************************************/
+static void dealMask(int degree, int32_t *records[3]) {
+	int32_t m = randMod(1);
+	int32_t mInv = powMod(m, MOD - 2);
+	int64_t power = m;
+	for (int i = 0; i <= degree; i++) {
+		int64_t r = randMod(0);
+		for (int j = 0; j < 3; j++) {
+			records[j][i] = (int32_t)(((j + 1) * r + power) % MOD);
+		}
+		power = (i == 0 ? mInv : power * mInv % MOD);
+	}
+	int64_t a1 = randMod(0), a2 = randMod(0);
+	for (int j = 0; j < 3; j++) {
+		records[j][degree + 1] = (int32_t)((a1 * (j + 1) + a2 * (j + 1) * (j + 1)) % MOD);
+	}
+}
+
+/*********************************************************************************
+ * @brief Open an agent's store, creating it when create is set.
+ * @return int: file descriptor, or -1 if the file does not exist and create is not set
+ *********************************************************************************/
+static int openPool(const char *dir, int agent, int width, int create) {
+	char path[4096];
+	poolPath(path, sizeof path, dir, agent, width);
+	int pfd = open(path, O_RDWR | (create ? O_CREAT | O_EXCL : 0), 0600);
+	if (pfd < 0 && !(errno == ENOENT && !create)) {
+		perror(path);
+		exit(EXIT_FAILURE);
+	}
+	return pfd;
+}
+
+/*********************************************************************************
+ * @brief Map the header of an open store.
+ *********************************************************************************/
+static pool_header_t *mapHeader(int pfd) {
+	void *p = mmap(NULL, sizeof(pool_header_t), PROT_READ | PROT_WRITE, MAP_SHARED, pfd, 0);
+	if (p == MAP_FAILED) {
+		perror("mmap");
+		exit(EXIT_FAILURE);
+	}
+	return (pool_header_t *)p;
+}
+
+/*********************************************************************************
+ * @brief Open the three stores of one width, creating a fresh run if none exist.
+ * @param const char *dir: store directory
+ * @param int width: comparison width
+ * @param int fds[3]: output file descriptors
+ * @param pool_header_t *hdr[3]: output mapped headers
+ * @return int: 1 on success, 0 if the stores do not exist and create is not set
+ *********************************************************************************/
+static int openRun(const char *dir, int width, int create, int fds[3], pool_header_t *hdr[3]) {
+	int present = 0;
+	for (int j = 0; j < 3; j++) {
+		fds[j] = openPool(dir, j + 1, width, 0);
+		present += fds[j] >= 0;
+	}
+	if (present == 0 && !create) return 0;
+	if (present != 0 && present != 3) {
+		fprintf(stderr, "Width %d: only %d of 3 stores present in %s\n", width, present, dir);
+		exit(EXIT_FAILURE);
+	}
+	if (present == 0) {
+		uint64_t run;
+		if (getrandom(&run, sizeof run, 0) != (ssize_t)sizeof run) {
+			perror("getrandom");
+			exit(EXIT_FAILURE);
+		}
+		for (int j = 0; j < 3; j++) {
+			fds[j] = openPool(dir, j + 1, width, 1);
+			pool_header_t init;
+			memset(&init, 0, sizeof init);
+			memcpy(init.magic, POOL_MAGIC, sizeof init.magic);
+			init.agent = (uint32_t)(j + 1);
+			init.degree = (uint32_t)width;
+			init.run = run;
+			if (pwrite(fds[j], &init, sizeof init, 0) != (ssize_t)sizeof init) {
+				perror("pwrite");
+				exit(EXIT_FAILURE);
+			}
+		}
+	}
+	for (int j = 0; j < 3; j++) {
+		hdr[j] = mapHeader(fds[j]);
+		if (memcmp(hdr[j]->magic, POOL_MAGIC, sizeof hdr[j]->magic) != 0 || hdr[j]->degree != (uint32_t)width || hdr[j]->run != hdr[0]->run) {
+			fprintf(stderr, "Width %d: stores in %s do not belong to the same run\n", width, dir);
+			exit(EXIT_FAILURE);
+		}
+	}
+	return 1;
+}
+
+static void closeRun(int fds[3], pool_header_t *hdr[3]) {
+	for (int j = 0; j < 3; j++) {
+		munmap(hdr[j], sizeof(pool_header_t));
+		close(fds[j]);
+	}
+}
+
+/*********************************************************************************
+ * @brief Append count masks to the three stores of one width.
+ * @note Records are written before capacity is raised, so an agent never reads a mask
+ *       that is still being written.
+ *********************************************************************************/
+static void appendMasks(int fds[3], pool_header_t *hdr[3], int width, uint64_t count) {
+	const size_t stride = POOL_STRIDE(width);
+	uint64_t capacity = atomic_load(&hdr[0]->capacity);
+	int32_t *chunk[3], *records[3];
+	for (int j = 0; j < 3; j++) {
+		chunk[j] = malloc(CHUNK * stride * sizeof(int32_t));
+		if (!chunk[j]) {
+			perror("malloc");
+			exit(EXIT_FAILURE);
+		}
+	}
+	for (uint64_t done = 0; done < count;) {
+		size_t n = (count - done < CHUNK) ? (size_t)(count - done) : CHUNK;
+		for (size_t k = 0; k < n; k++) {
+			for (int j = 0; j < 3; j++) {
+				records[j] = chunk[j] + k * stride;
+			}
+			dealMask(width, records);
+		}
+		off_t offset = (off_t)(sizeof(pool_header_t) + (capacity + done) * stride * sizeof(int32_t));
+		for (int j = 0; j < 3; j++) {
+			ssize_t bytes = (ssize_t)(n * stride * sizeof(int32_t));
+			if (pwrite(fds[j], chunk[j], bytes, offset) != bytes) {
+				perror("pwrite");
+				exit(EXIT_FAILURE);
+			}
+		}
+		done += n;
+	}
+	for (int j = 0; j < 3; j++) {
+		atomic_store_explicit(&hdr[j]->capacity, capacity + count, memory_order_release);
+		free(chunk[j]);
+	}
+}
+
+/*********************************************************************************
+ * @brief Masks left in a run, counted for the agent that has consumed the most.
+ *********************************************************************************/
+static uint64_t remaining(pool_header_t *hdr[3]) {
+	uint64_t left = UINT64_MAX;
+	for (int j = 0; j < 3; j++) {
+		uint64_t cap = atomic_load(&hdr[j]->capacity), cur = atomic_load(&hdr[j]->cursor);
+		uint64_t agentLeft = cap > cur ? cap - cur : 0;
+		if (agentLeft < left) left = agentLeft;
+	}
+	return left;
+}
+
+static int parseWidth(const char *arg) {
+	int width = atoi(arg);
+	if (width < 1 || width > l) {
+		fprintf(stderr, "Width must be between 1 and %d\n", l);
+		exit(EXIT_FAILURE);
+	}
+	return width;
+}
+
+static void usage(const char *prog) {
+	fprintf(stderr,
+	        "usage: %s gen <dir> <width> <count>             append count comparisons' worth of masks\n"
+	        "       %s status <dir>                          report masks left for every width\n"
+	        "       %s watch <dir> <width> <low> <count>     top up whenever fewer than low remain\n",
+	        prog, prog, prog);
+	exit(EXIT_FAILURE);
+}
+
+int main(int argc, char **argv) {
+	if (argc < 3) usage(argv[0]);
+	const char *dir = argv[2];
+	int fds[3];
+	pool_header_t *hdr[3];
+
+	if (strcmp(argv[1], "gen") == 0 && argc == 5) {
+		int width = parseWidth(argv[3]);
+		uint64_t count = strtoull(argv[4], NULL, 10) * (uint64_t)width;
+		openRun(dir, width, 1, fds, hdr);
+		appendMasks(fds, hdr, width, count);
+		printf("width %d: %llu masks left\n", width, (unsigned long long)remaining(hdr));
+		closeRun(fds, hdr);
+	} else if (strcmp(argv[1], "status") == 0 && argc == 3) {
+		for (int width = 1; width <= l; width++) {
+			if (!openRun(dir, width, 0, fds, hdr)) continue;
+			uint64_t left = remaining(hdr);
+			printf("width %d: %llu masks left, %llu comparisons (run %016llx)\n", width, (unsigned long long)left,
+			       (unsigned long long)(left / width), (unsigned long long)hdr[0]->run);
+			closeRun(fds, hdr);
+		}
+	} else if (strcmp(argv[1], "watch") == 0 && argc == 6) {
+		int width = parseWidth(argv[3]);
+		uint64_t low = strtoull(argv[4], NULL, 10) * (uint64_t)width;
+		uint64_t count = strtoull(argv[5], NULL, 10) * (uint64_t)width;
+		openRun(dir, width, 1, fds, hdr);
+		for (;;) {
+			if (remaining(hdr) < low) {
+				appendMasks(fds, hdr, width, count);
+				printf("width %d: refilled, %llu masks left\n", width, (unsigned long long)remaining(hdr));
+				fflush(stdout);
+			}
+			sleep(1);
+		}
+	} else {
+		usage(argv[0]);
+	}
+	return 0;
+}
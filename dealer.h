@@ -0,0 +1,46 @@
+#ifndef DEALER_H
+#define DEALER_H
+
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/*********************************************************************************
+ * @brief On-disk store of preprocessed randomness, shared by netint-dealer and agent.
+ * The dealer writes one file per agent and comparison width. Each file holds that agent's
+ * shares of zero-test masks, the randomness consumed by the preprocessed comparison backend.
+ * A mask of degree D is D + 2 int32 shares in host byte order: a random nonzero m, the
+ * inverse powers m^-1 ... m^-D, and a degree-2 sharing of zero.
+ *
+ * The dealer only ever appends. It publishes new masks by raising capacity, and the agent
+ * consumes them in order by advancing cursor. The three files of one run stay aligned as
+ * long as the agents see the same sequence of batched comparisons.
+ *********************************************************************************/
+#define POOL_MAGIC "NIPOOL1"
+#define POOL_STRIDE(degree) ((size_t)(degree) + 2)
+
+typedef struct {
+	char magic[8];
+	uint32_t agent;            /* Party index 1..3 whose shares the file holds */
+	uint32_t degree;           /* Mask degree, which is the comparison width */
+	uint64_t run;              /* Random id shared by the three files of one dealer run */
+	_Atomic uint64_t capacity; /* Masks written */
+	_Atomic uint64_t cursor;   /* Masks consumed by the agent */
+	uint8_t pad[24];
+} pool_header_t;
+
+_Static_assert(sizeof(pool_header_t) == 64, "pool header must stay one cache line");
+
+/*********************************************************************************
+ * @brief Build the path of an agent's store for one width.
+ * @param char *buf: output buffer
+ * @param size_t len: size of buf
+ * @param const char *dir: store directory
+ * @param int agent: party index 1..3
+ * @param int width: comparison width
+ *********************************************************************************/
+static inline void poolPath(char *buf, size_t len, const char *dir, int agent, int width) {
+	snprintf(buf, len, "%s/agent%d-w%d.pool", dir, agent, width);
+}
+
+#endif /* DEALER_H */
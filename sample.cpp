@@ -3,16 +3,36 @@
 // original code snippet from https://www.programiz.com/cpp-programming/examples/matrix-multiplication-function
 using namespace std;
 
-void enterData(NetInt firstMatrix[][10], NetInt secondMatrix[][10], NetInt rowFirst, NetInt columnFirst, NetInt rowSecond, NetInt columnSecond);
-void multiplyMatrices(NetInt firstMatrix[][10], NetInt secondMatrix[][10], NetInt multResult[][10], NetInt rowFirst, NetInt columnFirst, NetInt rowSecond, NetInt columnSecond);
-void display(NetInt mult[][10], NetInt rowFirst, NetInt columnSecond);
+void enterData(NetInt firstMatrix[][10], NetInt secondMatrix[][10], PublicInt rowFirst, PublicInt columnFirst, PublicInt rowSecond, PublicInt columnSecond);
+void multiplyMatrices(NetInt firstMatrix[][10], NetInt secondMatrix[][10], NetInt multResult[][10], PublicInt rowFirst, PublicInt columnFirst, PublicInt rowSecond, PublicInt columnSecond);
+void display(NetInt mult[][10], PublicInt rowFirst, PublicInt columnSecond);
 
-int main() {
+int main(int argc, char **argv) {
 	hideMessages(true);
 	setWhitelist({"127.0.0.1", "10.0.0.1"});
 	establishPort("8081");
 
-	NetInt firstMatrix[10][10], secondMatrix[10][10], mult[10][10], rowFirst, columnFirst, rowSecond, columnSecond, i, j, k;
+	// With two CSV files, one row per line, load both matrices in bulk instead of prompting
+	if (argc == 3) {
+		NetIntMatrix first = loadSecretMatrix(argv[1]), second = loadSecretMatrix(argv[2]);
+		if (first.cols != second.rows) {
+			cout << "Error! column of first matrix not equal to row of second." << endl;
+			return 1;
+		}
+		NetIntMatrix product = secureMatMul(first, second);
+		cout << "Output Matrix:" << endl;
+		for (size_t i = 0; i < product.rows; ++i) {
+			for (size_t j = 0; j < product.cols; ++j) {
+				cout << product(i, j) << " ";
+			}
+			cout << endl
+				 << endl;
+		}
+		return 0;
+	}
+
+	NetInt firstMatrix[10][10], secondMatrix[10][10], mult[10][10];
+	PublicInt rowFirst, columnFirst, rowSecond, columnSecond;
 
 	cout << "Enter rows and column for first matrix: ";
 	cin >> rowFirst >> columnFirst;
@@ -41,14 +61,14 @@ int main() {
 	return 0;
 }
 
-void enterData(NetInt firstMatrix[][10], NetInt secondMatrix[][10], NetInt rowFirst, NetInt columnFirst, NetInt rowSecond, NetInt columnSecond) {
-	NetInt i, j;
+void enterData(NetInt firstMatrix[][10], NetInt secondMatrix[][10], PublicInt rowFirst, PublicInt columnFirst, PublicInt rowSecond, PublicInt columnSecond) {
+	PublicInt i, j;
 	cout << endl
 		 << "Enter elements of matrix 1:" << endl;
 	for (i = 0; i < rowFirst; ++i) {
 		for (j = 0; j < columnFirst; ++j) {
 			cout << "Enter elements a" << i + 1 << j + 1 << ": ";
-			cin >> firstMatrix[i.value][j.value];
+			cin >> firstMatrix[i][j];
 		}
 	}
 
@@ -57,38 +77,42 @@ void enterData(NetInt firstMatrix[][10], NetInt secondMatrix[][10], NetInt rowFi
 	for (i = 0; i < rowSecond; ++i) {
 		for (j = 0; j < columnSecond; ++j) {
 			cout << "Enter elements b" << i + 1 << j + 1 << ": ";
-			cin >> secondMatrix[i.value][j.value];
+			cin >> secondMatrix[i][j];
 		}
 	}
 }
 
-void multiplyMatrices(NetInt firstMatrix[][10], NetInt secondMatrix[][10], NetInt mult[][10], NetInt rowFirst, NetInt columnFirst, NetInt rowSecond, NetInt columnSecond) {
-	NetInt i, j, k;
+void multiplyMatrices(NetInt firstMatrix[][10], NetInt secondMatrix[][10], NetInt mult[][10], PublicInt rowFirst, PublicInt columnFirst, PublicInt rowSecond, PublicInt columnSecond) {
+	PublicInt i, j;
+	NetIntMatrix first(rowFirst, columnFirst), second(rowSecond, columnSecond);
 
-	// Initializing elements of matrix mult to 0.
 	for (i = 0; i < rowFirst; ++i) {
+		for (j = 0; j < columnFirst; ++j) {
+			first(i, j) = firstMatrix[i][j];
+		}
+	}
+	for (i = 0; i < rowSecond; ++i) {
 		for (j = 0; j < columnSecond; ++j) {
-			mult[i.value][j.value] = 0;
+			second(i, j) = secondMatrix[i][j];
 		}
 	}
 
-	// Multiplying matrix firstMatrix and secondMatrix and storing in array mult.
+	// Multiplying matrix firstMatrix and secondMatrix in one batched round and storing in array mult.
+	NetIntMatrix product = secureMatMul(first, second);
 	for (i = 0; i < rowFirst; ++i) {
 		for (j = 0; j < columnSecond; ++j) {
-			for (k = 0; k < columnFirst; ++k) {
-				mult[i.value][j.value] += firstMatrix[i.value][k.value] * secondMatrix[k.value][j.value];
-			}
+			mult[i][j] = product(i, j);
 		}
 	}
 }
 
-void display(NetInt mult[][10], NetInt rowFirst, NetInt columnSecond) {
-	NetInt i, j;
+void display(NetInt mult[][10], PublicInt rowFirst, PublicInt columnSecond) {
+	PublicInt i, j;
 
 	cout << "Output Matrix:" << endl;
 	for (i = 0; i < rowFirst; ++i) {
 		for (j = 0; j < columnSecond; ++j) {
-			cout << mult[i.value][j.value] << " ";
+			cout << mult[i][j] << " ";
 			if (j == columnSecond - 1)
 				cout << endl
 					 << endl;
@@ -0,0 +1,186 @@
+#ifndef TRANSCRIPT_H
+#define TRANSCRIPT_H
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+/*********************************************************************************
+ * @brief Binary transcript of everything one party sent and received, for offline profiling.
+ * A header says whether the primary or an agent recorded it. Each send or receive then
+ * appends a record header followed by the bytes exactly as they crossed the wire. For an
+ * agent, connection 0 is the primary and 1..3 are its mesh peers. For the primary, 1..3 are
+ * the agents.
+ * NetInt.h writes and reads the same layout.
+ *
+ * Replaying feeds a party the bytes it received, in order per connection, and discards what
+ * it sends. The party runs its real code at full speed with no sockets, which makes its
+ * compute loops reproducible under a profiler.
+ *********************************************************************************/
+#define TRANSCRIPT_MAGIC "NITRACE1"
+#define TRANSCRIPT_CONNS 4
+
+enum { TRANSCRIPT_SENT = 0, TRANSCRIPT_RECEIVED = 1 };
+enum { TRANSCRIPT_PRIMARY = 0, TRANSCRIPT_AGENT = 1 };
+
+typedef struct {
+	char magic[8];
+	uint32_t role;     /* TRANSCRIPT_PRIMARY or TRANSCRIPT_AGENT */
+	uint32_t reserved;
+	uint64_t startNs;  /* CLOCK_MONOTONIC when recording began */
+	uint64_t reserved2;
+} transcript_header_t;
+
+typedef struct {
+	uint64_t ns;  /* Time since startNs */
+	uint32_t len; /* Bytes that follow the record header */
+	uint8_t dir;  /* TRANSCRIPT_SENT or TRANSCRIPT_RECEIVED */
+	uint8_t conn;
+	uint16_t pad;
+} transcript_record_t;
+
+_Static_assert(sizeof(transcript_header_t) == 32, "transcript header layout is shared with NetInt.h");
+_Static_assert(sizeof(transcript_record_t) == 16, "transcript record layout is shared with NetInt.h");
+
+static inline uint64_t transcriptNow(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+/*********************************************************************************
+ * @brief Transcript being recorded. Records are buffered by stdio.
+ *********************************************************************************/
+typedef struct {
+	FILE *file;
+	uint64_t start;
+} transcript_writer_t;
+
+/*********************************************************************************
+ * @brief Create a transcript file.
+ * @param transcript_writer_t *w: writer to set up
+ * @param const char *path: file to create or truncate
+ * @param uint32_t role: TRANSCRIPT_PRIMARY or TRANSCRIPT_AGENT
+ * @return int: 0 on success, -1 if the file cannot be written
+ *********************************************************************************/
+static inline int transcriptCreate(transcript_writer_t *w, const char *path, uint32_t role) {
+	w->file = fopen(path, "wb");
+	if (!w->file) return -1;
+	setvbuf(w->file, NULL, _IOFBF, 1 << 20);
+	w->start = transcriptNow();
+	transcript_header_t hdr;
+	memset(&hdr, 0, sizeof hdr);
+	memcpy(hdr.magic, TRANSCRIPT_MAGIC, sizeof hdr.magic);
+	hdr.role = role;
+	hdr.startNs = w->start;
+	return fwrite(&hdr, sizeof hdr, 1, w->file) == 1 ? 0 : -1;
+}
+
+static inline void transcriptRecord(transcript_writer_t *w, uint8_t dir, int conn, const void *buf, size_t len) {
+	if (!w->file || conn < 0 || len == 0) return;
+	transcript_record_t rec = {transcriptNow() - w->start, (uint32_t)len, dir, (uint8_t)conn, 0};
+	fwrite(&rec, sizeof rec, 1, w->file);
+	fwrite(buf, 1, len, w->file);
+}
+
+static inline void transcriptClose(transcript_writer_t *w) {
+	if (w->file) fclose(w->file);
+	w->file = NULL;
+}
+
+/*********************************************************************************
+ * @brief Memory-mapped transcript being replayed.
+ * Each connection keeps its own cursor: the offset of the record it is reading and how many
+ * of that record's bytes it has consumed.
+ *********************************************************************************/
+typedef struct {
+	const char *base;
+	size_t size;
+	struct {
+		size_t pos, used;
+	} streams[TRANSCRIPT_CONNS];
+} transcript_reader_t;
+
+/*********************************************************************************
+ * @brief Map a transcript for replay.
+ * @return int: role that recorded it, or -1 if the file is missing or not a transcript
+ *********************************************************************************/
+static inline int transcriptMap(transcript_reader_t *r, const char *path) {
+	int tfd = open(path, O_RDONLY);
+	if (tfd < 0) return -1;
+	struct stat st;
+	if (fstat(tfd, &st) != 0 || (size_t)st.st_size < sizeof(transcript_header_t)) {
+		close(tfd);
+		return -1;
+	}
+	void *p = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, tfd, 0);
+	close(tfd);
+	if (p == MAP_FAILED) return -1;
+	transcript_header_t hdr;
+	memcpy(&hdr, p, sizeof hdr);
+	if (memcmp(hdr.magic, TRANSCRIPT_MAGIC, sizeof hdr.magic) != 0) {
+		munmap(p, (size_t)st.st_size);
+		return -1;
+	}
+	madvise(p, (size_t)st.st_size, MADV_SEQUENTIAL);
+	r->base = (const char *)p;
+	r->size = (size_t)st.st_size;
+	for (int c = 0; c < TRANSCRIPT_CONNS; c++) {
+		r->streams[c].pos = sizeof hdr;
+		r->streams[c].used = 0;
+	}
+	return (int)hdr.role;
+}
+
+/*********************************************************************************
+ * @brief Copy the next bytes received on a connection.
+ * @param transcript_reader_t *r: mapped transcript
+ * @param int conn: connection
+ * @param void *buf: destination
+ * @param size_t len: bytes wanted
+ * @return size_t: bytes copied, less than len once the connection's recording ends
+ *********************************************************************************/
+static inline size_t transcriptRead(transcript_reader_t *r, int conn, void *buf, size_t len) {
+	size_t got = 0;
+	while (got < len) {
+		size_t pos = r->streams[conn].pos;
+		transcript_record_t rec;
+		if (pos + sizeof rec > r->size) break;
+		memcpy(&rec, r->base + pos, sizeof rec);
+		if (pos + sizeof rec + rec.len > r->size) break; // Cut short when the recorder died
+		if (rec.dir != TRANSCRIPT_RECEIVED || rec.conn != conn || r->streams[conn].used == rec.len) {
+			r->streams[conn].pos = pos + sizeof rec + rec.len;
+			r->streams[conn].used = 0;
+			continue;
+		}
+		size_t n = rec.len - r->streams[conn].used;
+		if (n > len - got) n = len - got;
+		memcpy((char *)buf + got, r->base + pos + sizeof rec + r->streams[conn].used, n);
+		r->streams[conn].used += n;
+		got += n;
+	}
+	return got;
+}
+
+/*********************************************************************************
+ * @brief Recorded duration of a transcript: the timestamp of its last complete record.
+ *********************************************************************************/
+static inline uint64_t transcriptDuration(const transcript_reader_t *r) {
+	uint64_t last = 0;
+	size_t pos = sizeof(transcript_header_t);
+	transcript_record_t rec;
+	while (pos + sizeof rec <= r->size) {
+		memcpy(&rec, r->base + pos, sizeof rec);
+		if (pos + sizeof rec + rec.len > r->size) break;
+		last = rec.ns;
+		pos += sizeof rec + rec.len;
+	}
+	return last;
+}
+
+#endif /* TRANSCRIPT_H */
@@ -0,0 +1,371 @@
+#ifndef URING_H
+#define URING_H
+
+#include <errno.h>
+#include <linux/io_uring.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+/*********************************************************************************
+ * @brief io_uring transport for the agent, built with make URING=1.
+ * Talks to the kernel through the raw io_uring system calls, so it needs no liburing.
+ * Every connection (the primary and the mesh peers) is a registered file with a multishot
+ * receive armed on it. Incoming bytes land in a ring of provided buffers and are copied
+ * into a per-connection stream that netringRecv reads from. Sends are queued and only
+ * submitted by the next wait, so the replies and renormalization shares of a protocol layer
+ * go out together with the io_uring_enter that waits for the answer. Each connection has at
+ * most one send in flight and the rest wait behind it in order, because the kernel may run
+ * two sends on one socket at once and a short send must finish before the next one starts.
+ *
+ * Needs Linux 6.0 or later for multishot receive. netringInit fails on older kernels and the
+ * agent falls back to plain send and recv.
+ *********************************************************************************/
+#define NETRING_CONNS 4         /* Primary plus up to three peers */
+#define NETRING_ENTRIES 64      /* Submission queue size */
+#define NETRING_BUFS 64         /* Provided receive buffers, a power of two */
+#define NETRING_BUF_SIZE 65536  /* Bytes per receive buffer */
+#define NETRING_SENDS 32        /* Sends in flight before the queue is flushed */
+
+enum { NETRING_RECV = 1, NETRING_SEND = 2 };
+
+typedef struct {
+	char *data;
+	size_t head, tail, cap; /* Unread bytes are data[head, tail) */
+	int fd;                 /* -1 when the slot is unused */
+	int eof;
+	int err;
+	int sendHead, sendTail; /* Send slots queued on this connection, -1 when idle */
+} netring_stream_t;
+
+typedef struct {
+	const char *buf; /* Points into the send staging area */
+	size_t len, done;
+	int conn;
+	int next; /* Send slot queued behind this one on the same connection, or -1 */
+} netring_send_t;
+
+static struct {
+	int ring;
+	unsigned *sqHead, *sqTail, *sqMask, *sqArray;
+	unsigned *cqHead, *cqTail, *cqMask;
+	struct io_uring_sqe *sqes;
+	struct io_uring_cqe *cqes;
+	unsigned queued; /* Entries written since the last io_uring_enter */
+	struct io_uring_buf_ring *bufRing;
+	char *bufs;
+	netring_stream_t conns[NETRING_CONNS];
+	netring_send_t sends[NETRING_SENDS];
+	unsigned inflight;
+	char *staging; /* Copies of queued send payloads, reset once nothing is in flight */
+	size_t stagingUsed, stagingCap;
+} netring = {.ring = -1};
+
+static struct io_uring_sqe *netringSqe(void);
+static void netringPump(int wait);
+
+/*********************************************************************************
+ * @brief Return a provided buffer to the kernel.
+ *********************************************************************************/
+static void netringRecycle(unsigned bid) {
+	unsigned short tail = netring.bufRing->tail;
+	struct io_uring_buf *b = &netring.bufRing->bufs[tail & (NETRING_BUFS - 1)];
+	b->addr = (uint64_t)(uintptr_t)(netring.bufs + (size_t)bid * NETRING_BUF_SIZE);
+	b->len = NETRING_BUF_SIZE;
+	b->bid = (unsigned short)bid;
+	__atomic_store_n(&netring.bufRing->tail, (unsigned short)(tail + 1), __ATOMIC_RELEASE);
+}
+
+static void netringArm(int conn) {
+	struct io_uring_sqe *sqe = netringSqe();
+	sqe->opcode = IORING_OP_RECV;
+	sqe->fd = conn;
+	sqe->flags = IOSQE_FIXED_FILE | IOSQE_BUFFER_SELECT;
+	sqe->ioprio = IORING_RECV_MULTISHOT;
+	sqe->buf_group = 0;
+	sqe->user_data = (uint64_t)conn << 8 | NETRING_RECV;
+}
+
+/*********************************************************************************
+ * @brief Set up the ring, the receive buffers, and the primary connection.
+ * @param int fd: socket connected to the primary
+ * @return int: 0 on success, -1 if the kernel lacks the features used here
+ *********************************************************************************/
+static int netringInit(int fd) {
+	struct io_uring_params p;
+	memset(&p, 0, sizeof p);
+	p.flags = IORING_SETUP_SINGLE_ISSUER | IORING_SETUP_DEFER_TASKRUN;
+	int ring = (int)syscall(__NR_io_uring_setup, NETRING_ENTRIES, &p);
+	if (ring < 0 && errno == EINVAL) {
+		memset(&p, 0, sizeof p);
+		ring = (int)syscall(__NR_io_uring_setup, NETRING_ENTRIES, &p);
+	}
+	if (ring < 0) return -1;
+	if (!(p.features & IORING_FEAT_SINGLE_MMAP)) {
+		close(ring);
+		return -1;
+	}
+
+	size_t sqLen = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+	size_t cqLen = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+	size_t len = sqLen > cqLen ? sqLen : cqLen;
+	char *rings = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring, IORING_OFF_SQ_RING);
+	void *sqes = mmap(NULL, p.sq_entries * sizeof(struct io_uring_sqe), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring, IORING_OFF_SQES);
+	void *bufRing = mmap(NULL, NETRING_BUFS * sizeof(struct io_uring_buf), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	netring.bufs = malloc((size_t)NETRING_BUFS * NETRING_BUF_SIZE);
+	if (rings == MAP_FAILED || sqes == MAP_FAILED || bufRing == MAP_FAILED || !netring.bufs) {
+		close(ring);
+		return -1;
+	}
+	netring.sqHead = (unsigned *)(rings + p.sq_off.head);
+	netring.sqTail = (unsigned *)(rings + p.sq_off.tail);
+	netring.sqMask = (unsigned *)(rings + p.sq_off.ring_mask);
+	netring.sqArray = (unsigned *)(rings + p.sq_off.array);
+	netring.cqHead = (unsigned *)(rings + p.cq_off.head);
+	netring.cqTail = (unsigned *)(rings + p.cq_off.tail);
+	netring.cqMask = (unsigned *)(rings + p.cq_off.ring_mask);
+	netring.cqes = (struct io_uring_cqe *)(rings + p.cq_off.cqes);
+	netring.sqes = sqes;
+	netring.bufRing = bufRing;
+
+	struct io_uring_buf_reg reg;
+	memset(&reg, 0, sizeof reg);
+	reg.ring_addr = (uint64_t)(uintptr_t)bufRing;
+	reg.ring_entries = NETRING_BUFS;
+	reg.bgid = 0;
+	int files[NETRING_CONNS];
+	for (int i = 0; i < NETRING_CONNS; i++) {
+		files[i] = -1;
+		netring.conns[i].fd = -1;
+		netring.conns[i].sendHead = netring.conns[i].sendTail = -1;
+	}
+	files[0] = fd;
+	if (syscall(__NR_io_uring_register, ring, IORING_REGISTER_PBUF_RING, &reg, 1) < 0 ||
+	    syscall(__NR_io_uring_register, ring, IORING_REGISTER_FILES, files, NETRING_CONNS) < 0) {
+		close(ring);
+		return -1;
+	}
+	netring.ring = ring;
+	for (unsigned bid = 0; bid < NETRING_BUFS; bid++) {
+		netringRecycle(bid);
+	}
+	netring.conns[0].fd = fd;
+	netringArm(0);
+	return 0;
+}
+
+/*********************************************************************************
+ * @brief Register another connection and start receiving on it.
+ * @param int conn: connection slot, 1 .. NETRING_CONNS - 1
+ * @param int fd: connected socket
+ *********************************************************************************/
+static void netringAdd(int conn, int fd) {
+	struct io_uring_files_update update;
+	memset(&update, 0, sizeof update);
+	update.offset = (unsigned)conn;
+	update.fds = (uint64_t)(uintptr_t)&fd;
+	if (syscall(__NR_io_uring_register, netring.ring, IORING_REGISTER_FILES_UPDATE, &update, 1) != 1) {
+		perror("io_uring_register");
+		exit(EXIT_FAILURE);
+	}
+	netring.conns[conn].fd = fd;
+	netringArm(conn);
+}
+
+/*********************************************************************************
+ * @brief Connection slot of a socket, or -1 if the ring does not own it.
+ *********************************************************************************/
+static int netringConn(int fd) {
+	if (netring.ring < 0) return -1;
+	for (int i = 0; i < NETRING_CONNS; i++) {
+		if (netring.conns[i].fd == fd) return i;
+	}
+	return -1;
+}
+
+/*********************************************************************************
+ * @brief Next free submission entry, zeroed. Submits the queue first if it is full.
+ *********************************************************************************/
+static struct io_uring_sqe *netringSqe(void) {
+	unsigned tail = *netring.sqTail;
+	if (tail - __atomic_load_n(netring.sqHead, __ATOMIC_ACQUIRE) >= NETRING_ENTRIES) {
+		netringPump(0);
+		tail = *netring.sqTail;
+	}
+	unsigned idx = tail & *netring.sqMask;
+	struct io_uring_sqe *sqe = &netring.sqes[idx];
+	memset(sqe, 0, sizeof *sqe);
+	netring.sqArray[idx] = idx;
+	__atomic_store_n(netring.sqTail, tail + 1, __ATOMIC_RELEASE);
+	netring.queued++;
+	return sqe;
+}
+
+static void netringQueueSend(unsigned slot) {
+	netring_send_t *s = &netring.sends[slot];
+	struct io_uring_sqe *sqe = netringSqe();
+	sqe->opcode = IORING_OP_SEND;
+	sqe->fd = s->conn;
+	sqe->flags = IOSQE_FIXED_FILE;
+	sqe->addr = (uint64_t)(uintptr_t)(s->buf + s->done);
+	sqe->len = (unsigned)(s->len - s->done);
+	sqe->msg_flags = MSG_WAITALL | MSG_NOSIGNAL;
+	sqe->user_data = (uint64_t)slot << 8 | NETRING_SEND;
+}
+
+/*********************************************************************************
+ * @brief Append received bytes to a connection's stream.
+ *********************************************************************************/
+static void netringAppend(netring_stream_t *c, const char *src, size_t len) {
+	if (c->head > 0 && c->tail + len > c->cap) {
+		memmove(c->data, c->data + c->head, c->tail - c->head);
+		c->tail -= c->head;
+		c->head = 0;
+	}
+	if (c->tail + len > c->cap) {
+		size_t cap = c->cap ? c->cap : NETRING_BUF_SIZE;
+		while (cap < c->tail + len) cap *= 2;
+		c->data = realloc(c->data, cap);
+		if (!c->data) {
+			perror("realloc");
+			exit(EXIT_FAILURE);
+		}
+		c->cap = cap;
+	}
+	memcpy(c->data + c->tail, src, len);
+	c->tail += len;
+}
+
+/*********************************************************************************
+ * @brief Submit queued entries and handle every completion that is ready.
+ * @param int wait: block until at least one completion arrives
+ *********************************************************************************/
+static void netringPump(int wait) {
+	unsigned flags = wait ? IORING_ENTER_GETEVENTS : 0;
+	for (;;) {
+		int r = (int)syscall(__NR_io_uring_enter, netring.ring, netring.queued, wait ? 1 : 0, flags, NULL, 0);
+		if (r >= 0) break;
+		if (errno != EINTR) {
+			perror("io_uring_enter");
+			exit(EXIT_FAILURE);
+		}
+	}
+	netring.queued = 0;
+
+	unsigned head = *netring.cqHead;
+	unsigned tail = __atomic_load_n(netring.cqTail, __ATOMIC_ACQUIRE);
+	for (; head != tail; head++) {
+		struct io_uring_cqe *cqe = &netring.cqes[head & *netring.cqMask];
+		unsigned index = (unsigned)(cqe->user_data >> 8);
+		if ((cqe->user_data & 0xff) == NETRING_RECV) {
+			netring_stream_t *c = &netring.conns[index];
+			if (cqe->res > 0) {
+				unsigned bid = cqe->flags >> IORING_CQE_BUFFER_SHIFT;
+				netringAppend(c, netring.bufs + (size_t)bid * NETRING_BUF_SIZE, (size_t)cqe->res);
+				netringRecycle(bid);
+			} else if (cqe->res == 0) {
+				c->eof = 1;
+			} else if (cqe->res != -ENOBUFS) {
+				c->err = -cqe->res;
+			}
+			// The kernel stops a multishot receive when it runs out of buffers
+			if (!(cqe->flags & IORING_CQE_F_MORE) && !c->eof && !c->err) netringArm((int)index);
+		} else {
+			netring_send_t *s = &netring.sends[index];
+			if (cqe->res < 0) {
+				errno = -cqe->res;
+				perror("send");
+				exit(EXIT_FAILURE);
+			}
+			s->done += (size_t)cqe->res;
+			if (s->done < s->len) {
+				netringQueueSend(index);
+			} else {
+				// Start the next send on this connection only now that this one is complete
+				netring_stream_t *c = &netring.conns[s->conn];
+				s->len = 0;
+				netring.inflight--;
+				c->sendHead = s->next;
+				if (c->sendHead < 0) {
+					c->sendTail = -1;
+				} else {
+					netringQueueSend((unsigned)c->sendHead);
+				}
+			}
+		}
+	}
+	__atomic_store_n(netring.cqHead, head, __ATOMIC_RELEASE);
+	if (netring.inflight == 0) netring.stagingUsed = 0;
+}
+
+/*********************************************************************************
+ * @brief Wait until every queued send has completed.
+ *********************************************************************************/
+static void netringFlush(void) {
+	while (netring.inflight > 0) netringPump(1);
+}
+
+/*********************************************************************************
+ * @brief Queue bytes for a connection. They go out with the next wait or flush, after
+ *        any earlier sends on the same connection.
+ * @param int conn: connection slot
+ * @param const void *buf: data, copied before returning
+ * @param size_t len: number of bytes
+ *********************************************************************************/
+static void netringSend(int conn, const void *buf, size_t len) {
+	if (len == 0) return;
+	if (netring.inflight == NETRING_SENDS || netring.stagingUsed + len > netring.stagingCap) netringFlush();
+	if (len > netring.stagingCap) {
+		size_t cap = netring.stagingCap ? netring.stagingCap : NETRING_BUF_SIZE;
+		while (cap < len) cap *= 2;
+		free(netring.staging);
+		netring.staging = malloc(cap);
+		if (!netring.staging) {
+			perror("malloc");
+			exit(EXIT_FAILURE);
+		}
+		netring.stagingCap = cap;
+	}
+	unsigned slot = 0;
+	while (netring.sends[slot].len != 0) slot++;
+	char *copy = netring.staging + netring.stagingUsed;
+	memcpy(copy, buf, len);
+	netring.stagingUsed += len;
+	netring.sends[slot] = (netring_send_t){copy, len, 0, conn, -1};
+	netring.inflight++;
+	netring_stream_t *c = &netring.conns[conn];
+	if (c->sendTail < 0) {
+		c->sendHead = c->sendTail = (int)slot;
+		netringQueueSend(slot);
+	} else {
+		netring.sends[c->sendTail].next = (int)slot;
+		c->sendTail = (int)slot;
+	}
+}
+
+/*********************************************************************************
+ * @brief Read exactly len bytes from a connection's stream.
+ * @return ssize_t: len, 0 if the peer closed first, or -1 on error
+ *********************************************************************************/
+static ssize_t netringRecv(int conn, void *buf, size_t len) {
+	netring_stream_t *c = &netring.conns[conn];
+	while (c->tail - c->head < len) {
+		if (c->eof) return 0;
+		if (c->err) {
+			errno = c->err;
+			return -1;
+		}
+		netringPump(1);
+	}
+	memcpy(buf, c->data + c->head, len);
+	c->head += len;
+	if (c->head == c->tail) c->head = c->tail = 0;
+	return (ssize_t)len;
+}
+
+#endif /* URING_H */